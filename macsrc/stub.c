@@ -18,7 +18,10 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
+#define _POSIX_C_SOURCE 200112L	/* clock_nanosleep under -ansi */
+
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdio.h>
 
@@ -88,42 +91,74 @@ void ShareWareEnd(void)
         SetAPalette(rBlackPal);
 }
 
-Word WaitEvent(void)
+/* Ticks count at 60 Hz off CLOCK_MONOTONIC; the waits below sleep up to */
+/* the next tick with clock_nanosleep() between event polls, where the Mac */
+/* code used to spin */
+
+#define NSPERTICK	16667000L	/* 1/60 s rounded up to a whole usec */
+
+static struct timespec t0;
+
+static void StartTicks(void)
 {
-	while (DoEvents() == 0) ;
-	
-	return 0;
+	if (t0.tv_sec == 0 && t0.tv_nsec == 0)
+		clock_gettime(CLOCK_MONOTONIC, &t0);
 }
 
-static struct timeval t0;
-
 LongWord ReadTick()
 {
-	struct timeval t1;
-	int secs, usecs;
+	struct timespec t1;
+	long secs, nsecs;
 	
-	if (t0.tv_sec == 0) {
-		gettimeofday(&t0, NULL);
+	if (t0.tv_sec == 0 && t0.tv_nsec == 0) {
+		StartTicks();
 		return 0;
 	}
 	
-	gettimeofday(&t1, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
 	
 	secs  = t1.tv_sec - t0.tv_sec;
-	usecs = t1.tv_usec - t0.tv_usec;
-	if (usecs < 0) {
-		usecs += 1000000;
+	nsecs = t1.tv_nsec - t0.tv_nsec;
+	if (nsecs < 0) {
+		nsecs += 1000000000L;
 		secs--;
 	}
 	
-	return secs * 60 + usecs * 60 / 1000000;
+	return secs * 60 + (nsecs / 1000) * 60 / 1000000;
+}
+
+/* Sleeps until ReadTick() reaches Tick */
+
+static void SleepTick(LongWord Tick)
+{
+	struct timespec t;
+	
+	StartTicks();
+	
+	while ((long)(Tick - ReadTick()) > 0) {
+		t.tv_sec = t0.tv_sec + Tick / 60;
+		t.tv_nsec = t0.tv_nsec + (Tick % 60) * NSPERTICK;
+		if (t.tv_nsec >= 1000000000L) {
+			t.tv_nsec -= 1000000000L;
+			t.tv_sec++;
+		}
+		
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+	}
+}
+
+Word WaitEvent(void)
+{
+	while (DoEvents() == 0)
+		SleepTick(ReadTick() + 1);
+	
+	return 0;
 }
 
 void WaitTick()
 {
-	do {
-		DoEvents();
-	} while (ReadTick() == LastTick);
+	DoEvents();
+	SleepTick(LastTick + 1);
 	LastTick = ReadTick();
 }
 
@@ -131,10 +166,13 @@ void WaitTicks(Word Count)
 {
 	LongWord TickMark;
 	
-	do {
+	for (;;) {
 		DoEvents();
 		TickMark = ReadTick();
-	} while ((TickMark-LastTick)<=Count);
+		if ((TickMark-LastTick) > Count)
+			break;
+		SleepTick(TickMark + 1);
+	}
 	LastTick = TickMark;
 }
 
@@ -157,6 +195,8 @@ Word WaitTicksEvent(Word Time)
 				break;
 			}
 		}
+		
+		SleepTick(NewMark + 1);
 	}	
 	return RetVal;
 }
@@ -0,0 +1,385 @@
+/* demofarm: replays a directory of demos on headless copies of the game */
+/* (nwolf3d -timedemo) spread over several processes, and writes what they */
+/* report out as one JSON file */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+
+#define FRAMEHIST	10		/* must match PrintDemoStats in wl_game.c */
+#define MAXOUTPUT	8192
+#define MAXJOBS		64
+
+typedef struct
+{
+	char	*path;
+	int	ok;
+	int	status;
+	char	hash[9];
+	long	tics, frames, usec;
+	long	hist[FRAMEHIST];
+} demo_t;
+
+typedef struct
+{
+	pid_t	pid;
+	int	fd;
+	int	demo;
+	int	len;
+	char	output[MAXOUTPUT];
+} worker_t;
+
+static demo_t *demos;
+static int numdemos;
+
+static const char *game = "./nwolf3d";
+static const char *mode = "-timedemo";
+
+/*
+==========================
+=
+= FindDemos
+=
+= Collects every *.dem in the directory, sorted by name
+=
+==========================
+*/
+
+static int CompareDemos(const void *a, const void *b)
+{
+	return strcmp(((const demo_t *)a)->path, ((const demo_t *)b)->path);
+}
+
+static void FindDemos(const char *dir)
+{
+	DIR *d;
+	struct dirent *de;
+	int len, size;
+
+	d = opendir(dir);
+	if (d == NULL) {
+		fprintf(stderr, "demofarm: %s: %s\n", dir, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	size = 0;
+	while ((de = readdir(d)) != NULL) {
+		len = strlen(de->d_name);
+		if (len < 5 || strcasecmp(de->d_name + len - 4, ".dem"))
+			continue;
+
+		if (numdemos == size) {
+			size = size ? size * 2 : 64;
+			demos = realloc(demos, size * sizeof(demo_t));
+			if (demos == NULL) {
+				fprintf(stderr, "demofarm: out of memory\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		memset(&demos[numdemos], 0, sizeof(demo_t));
+		demos[numdemos].path = malloc(strlen(dir) + len + 2);
+		sprintf(demos[numdemos].path, "%s/%s", dir, de->d_name);
+		numdemos++;
+	}
+
+	closedir(d);
+
+	qsort(demos, numdemos, sizeof(demo_t), CompareDemos);
+}
+
+/*
+==========================
+=
+= StartWorker
+=
+==========================
+*/
+
+static void StartWorker(worker_t *w, int demo)
+{
+	int fds[2];
+
+	if (pipe(fds) == -1) {
+		perror("demofarm: pipe");
+		exit(EXIT_FAILURE);
+	}
+
+	w->pid = fork();
+	if (w->pid == -1) {
+		perror("demofarm: fork");
+		exit(EXIT_FAILURE);
+	}
+
+	if (w->pid == 0) {
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[1]);
+
+		execl(game, game, mode, "-playdemo", demos[demo].path, (char *)NULL);
+
+		fprintf(stderr, "demofarm: %s: %s\n", game, strerror(errno));
+		_exit(127);
+	}
+
+	close(fds[1]);
+
+	w->fd = fds[0];
+	w->demo = demo;
+	w->len = 0;
+}
+
+/*
+==========================
+=
+= FinishWorker
+=
+= Reaps the process and picks the "demo ..." line out of what it printed
+=
+==========================
+*/
+
+static void FinishWorker(worker_t *w)
+{
+	demo_t *d = &demos[w->demo];
+	char *line, *p;
+	int i, n;
+
+	close(w->fd);
+	w->fd = -1;
+
+	waitpid(w->pid, &d->status, 0);
+
+	w->output[w->len] = 0;
+	for (line = strtok(w->output, "\n"); line; line = strtok(NULL, "\n")) {
+		if (strncmp(line, "demo ", 5))
+			continue;
+
+		p = strstr(line, " hash ");
+		if (p == NULL)
+			continue;
+
+		n = 0;
+		if (sscanf(p, " hash %8s tics %ld frames %ld usec %ld hist%n",
+			d->hash, &d->tics, &d->frames, &d->usec, &n) != 4 || !n)
+			continue;
+
+		p += n;
+		for (i = 0; i < FRAMEHIST; i++)
+			d->hist[i] = strtol(p, &p, 10);
+
+		d->ok = WIFEXITED(d->status) && WEXITSTATUS(d->status) == 0;
+	}
+
+	fprintf(stderr, "%-40s %s\n", d->path, d->ok ? d->hash : "FAILED");
+}
+
+/*
+==========================
+=
+= RunDemos
+=
+==========================
+*/
+
+static void RunDemos(int jobs)
+{
+	worker_t workers[MAXJOBS];
+	fd_set set;
+	int next, active, maxfd, i, n;
+
+	for (i = 0; i < jobs; i++)
+		workers[i].fd = -1;
+
+	next = active = 0;
+	while (next < numdemos || active) {
+		for (i = 0; i < jobs && next < numdemos; i++)
+			if (workers[i].fd == -1) {
+				StartWorker(&workers[i], next++);
+				active++;
+			}
+
+		FD_ZERO(&set);
+		maxfd = -1;
+		for (i = 0; i < jobs; i++)
+			if (workers[i].fd != -1) {
+				FD_SET(workers[i].fd, &set);
+				if (workers[i].fd > maxfd)
+					maxfd = workers[i].fd;
+			}
+
+		if (select(maxfd + 1, &set, NULL, NULL, NULL) == -1) {
+			if (errno == EINTR)
+				continue;
+			perror("demofarm: select");
+			exit(EXIT_FAILURE);
+		}
+
+		for (i = 0; i < jobs; i++) {
+			worker_t *w = &workers[i];
+			char discard[512];
+
+			if (w->fd == -1 || !FD_ISSET(w->fd, &set))
+				continue;
+
+			if (w->len < MAXOUTPUT - 1)
+				n = read(w->fd, w->output + w->len, MAXOUTPUT - 1 - w->len);
+			else
+				n = read(w->fd, discard, sizeof(discard));
+
+			if (n > 0) {
+				if (w->len < MAXOUTPUT - 1)
+					w->len += n;
+			} else if (n == 0 || errno != EINTR) {
+				FinishWorker(w);
+				active--;
+			}
+		}
+	}
+}
+
+/*
+==========================
+=
+= WriteReport
+=
+==========================
+*/
+
+static void WriteString(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", *s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void WriteReport(FILE *f, int jobs, long wallusec)
+{
+	long frames, usec;
+	int i, j, failed;
+
+	frames = usec = 0;
+	failed = 0;
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"game\": ");
+	WriteString(f, game);
+	fprintf(f, ",\n  \"mode\": \"%s\",\n", mode + 1);
+	fprintf(f, "  \"workers\": %d,\n", jobs);
+	fprintf(f, "  \"histogram_us\": [");
+	for (j = 0; j < FRAMEHIST - 1; j++)
+		fprintf(f, "\"<%ld\", ", 64l << j);
+	fprintf(f, "\">=%ld\"", 64l << (FRAMEHIST - 2));
+	fprintf(f, "],\n");
+	fprintf(f, "  \"demos\": [\n");
+
+	for (i = 0; i < numdemos; i++) {
+		demo_t *d = &demos[i];
+
+		fprintf(f, "    { \"file\": ");
+		WriteString(f, d->path);
+
+		if (d->ok) {
+			fprintf(f, ", \"ok\": true, \"hash\": \"%s\", \"tics\": %ld, \"frames\": %ld, \"usec\": %ld",
+				d->hash, d->tics, d->frames, d->usec);
+			fprintf(f, ", \"fps\": %.1f", d->usec ? d->frames * 1e6 / d->usec : 0.0);
+			fprintf(f, ", \"histogram\": [");
+			for (j = 0; j < FRAMEHIST; j++)
+				fprintf(f, "%s%ld", j ? ", " : "", d->hist[j]);
+			fprintf(f, "] }");
+
+			frames += d->frames;
+			usec += d->usec;
+		} else {
+			fprintf(f, ", \"ok\": false, \"exit\": %d }",
+				WIFEXITED(d->status) ? WEXITSTATUS(d->status) : -1);
+			failed++;
+		}
+
+		fprintf(f, "%s\n", i < numdemos - 1 ? "," : "");
+	}
+
+	fprintf(f, "  ],\n");
+	fprintf(f, "  \"totals\": { \"demos\": %d, \"failed\": %d, \"frames\": %ld, \"usec\": %ld, \"fps\": %.1f, \"wall_ms\": %ld }\n",
+		numdemos, failed, frames, usec, usec ? frames * 1e6 / usec : 0.0, wallusec / 1000);
+	fprintf(f, "}\n");
+}
+
+static void Usage(void)
+{
+	fprintf(stderr, "usage: demofarm [-j jobs] [-o report.json] [-g game] [-simonly] demodir\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timeval t0, t1;
+	const char *report = NULL, *dir = NULL;
+	FILE *f;
+	int jobs, i, failed;
+
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			jobs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			report = argv[++i];
+		else if (!strcmp(argv[i], "-g") && i + 1 < argc)
+			game = argv[++i];
+		else if (!strcmp(argv[i], "-simonly"))
+			mode = "-simonly";
+		else if (argv[i][0] != '-' && dir == NULL)
+			dir = argv[i];
+		else
+			Usage();
+	}
+
+	if (dir == NULL)
+		Usage();
+
+	if (jobs < 1)
+		jobs = 1;
+	if (jobs > MAXJOBS)
+		jobs = MAXJOBS;
+
+	FindDemos(dir);
+	if (jobs > numdemos && numdemos)
+		jobs = numdemos;
+
+	gettimeofday(&t0, NULL);
+	RunDemos(jobs);
+	gettimeofday(&t1, NULL);
+
+	f = report ? fopen(report, "w") : stdout;
+	if (f == NULL) {
+		fprintf(stderr, "demofarm: %s: %s\n", report, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	WriteReport(f, jobs, (t1.tv_sec - t0.tv_sec) * 1000000l + t1.tv_usec - t0.tv_usec);
+
+	if (f != stdout)
+		fclose(f);
+
+	failed = 0;
+	for (i = 0; i < numdemos; i++)
+		failed += !demos[i].ok;
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
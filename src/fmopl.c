@@ -255,7 +255,7 @@ INLINE void OPL_KEYOFF(OPL_SLOT *SLOT)
 
 /* ---------- Envelope Generator & Phase Generator ---------- */
 /* return : envelope output */
-INLINE UINT32 OPL_CALC_SLOT( OPL_SLOT *SLOT )
+INLINE UINT32 OPL_CALC_SLOT_AMS( OPL_SLOT *SLOT, INT32 ams )
 {
 	/* calculate envelope generator */
 	if( (SLOT->evc+=SLOT->evs) >= SLOT->eve )
@@ -292,6 +292,8 @@ INLINE UINT32 OPL_CALC_SLOT( OPL_SLOT *SLOT )
 	return SLOT->TLL+ENV_CURVE[SLOT->evc>>ENV_BITS]+(SLOT->ams ? ams : 0);
 }
 
+#define OPL_CALC_SLOT(SLOT)	OPL_CALC_SLOT_AMS(SLOT,ams)
+
 /* set algorythm connection */
 static void set_algorythm( OPL_CH *CH)
 {
@@ -513,6 +515,69 @@ INLINE void OPL_CALC_RH( OPL_CH *CH )
 		outd[0] += OP_OUT(SLOT7_2,env_hh,tone8)*2;
 }
 
+/* ---------- block per channel core ---------- */
+/* everything it touches lives in the chip, so chips can run side by side */
+
+#define OPL_BLOCK 64
+
+/* a slot that can't change or be heard until the next register write */
+INLINE int OPL_SLOT_SILENT( OPL_SLOT *SLOT )
+{
+	return SLOT->evs == 0 && SLOT->evc < SLOT->eve &&
+		SLOT->TLL+ENV_CURVE[SLOT->evc>>ENV_BITS] >= EG_ENT-1;
+}
+
+/* OPL_CALC_CH for length samples of one channel, added into out */
+INLINE void OPL_CALC_CH_BLOCK( OPL_CH *CH, INT32 *out, const INT32 *amsbuf,
+	const INT32 *vibbuf, int length )
+{
+	OPL_SLOT *MOD = &CH->SLOT[SLOT1];
+	OPL_SLOT *CAR = &CH->SLOT[SLOT2];
+	UINT32 env_out;
+	INT32 op, fb2;
+	int i;
+
+	for( i=0; i < length ; i++ )
+	{
+		fb2 = 0;
+		/* SLOT 1 */
+		env_out=OPL_CALC_SLOT_AMS(MOD,amsbuf[i]);
+		if( env_out < EG_ENT-1 )
+		{
+			/* PG */
+			if(MOD->vib) MOD->Cnt += (MOD->Incr*vibbuf[i]/VIB_RATE);
+			else         MOD->Cnt += MOD->Incr;
+			/* connection */
+			if(CH->FB)
+			{
+				int feedback1 = (CH->op1_out[0]+CH->op1_out[1])>>CH->FB;
+				CH->op1_out[1] = CH->op1_out[0];
+				op = CH->op1_out[0] = OP_OUT(MOD,env_out,feedback1);
+			}
+			else
+			{
+				op = OP_OUT(MOD,env_out,0);
+			}
+			if(CH->CON) out[i] += op;
+			else        fb2 = op;
+		}else
+		{
+			CH->op1_out[1] = CH->op1_out[0];
+			CH->op1_out[0] = 0;
+		}
+		/* SLOT 2 */
+		env_out=OPL_CALC_SLOT_AMS(CAR,amsbuf[i]);
+		if( env_out < EG_ENT-1 )
+		{
+			/* PG */
+			if(CAR->vib) CAR->Cnt += (CAR->Incr*vibbuf[i]/VIB_RATE);
+			else         CAR->Cnt += CAR->Incr;
+			/* connection */
+			out[i] += OP_OUT(CAR,env_out,fb2);
+		}
+	}
+}
+
 /* ----------- initialize time tabls ----------- */
 static void init_timetables( FM_OPL *OPL , int ARRATE , int DRRATE )
 {
@@ -870,7 +935,9 @@ static void OPL_UnLockTable(void)
 }
 
 /* ---------- update chip ----------- */
-void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
+/* the original core, one sample of every channel at a time; */
+/* -oplbench checks YM3812UpdateOne against it */
+void YM3812UpdateRef(FM_OPL *OPL, INT16 *buffer, int length)
 {
     int i;
 	int data;
@@ -928,6 +995,57 @@ void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
 #endif
 }
 
+/* block at a time, channel by channel, skipping silent channels */
+void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
+{
+	INT32 out[OPL_BLOCK], amsbuf[OPL_BLOCK], vibbuf[OPL_BLOCK];
+	UINT32 amsCnt, vibCnt;
+	OPL_CH *CH;
+	int i, n;
+
+	/* rythm mode still runs through the shared state of the old core */
+	if( OPL->rythm&0x20 )
+	{
+		YM3812UpdateRef(OPL, buffer, length);
+		return;
+	}
+
+	for( ; length > 0 ; length -= n, buffer += n )
+	{
+		n = length < OPL_BLOCK ? length : OPL_BLOCK;
+
+		/* LFO */
+		amsCnt = OPL->amsCnt;
+		vibCnt = OPL->vibCnt;
+		for( i=0; i < n ; i++ )
+		{
+			amsbuf[i] = OPL->ams_table[(amsCnt+=OPL->amsIncr)>>AMS_SHIFT];
+			vibbuf[i] = OPL->vib_table[(vibCnt+=OPL->vibIncr)>>VIB_SHIFT];
+		}
+		OPL->amsCnt = amsCnt;
+		OPL->vibCnt = vibCnt;
+
+		memset(out, 0, n*sizeof(INT32));
+
+		/* FM part */
+		for( CH=OPL->P_CH ; CH < &OPL->P_CH[9] ; CH++ )
+		{
+			if( OPL_SLOT_SILENT(&CH->SLOT[SLOT1]) && OPL_SLOT_SILENT(&CH->SLOT[SLOT2]) )
+			{
+				/* what n samples of nothing would have left behind */
+				CH->op1_out[1] = n > 1 ? 0 : CH->op1_out[0];
+				CH->op1_out[0] = 0;
+				continue;
+			}
+			OPL_CALC_CH_BLOCK(CH, out, amsbuf, vibbuf, n);
+		}
+
+		/* limit check, store to sound buffer */
+		for( i=0; i < n ; i++ )
+			buffer[i] = Limit( out[i] , OPL_MAXOUT, OPL_MINOUT ) >> OPL_OUTSB;
+	}
+}
+
 /* ---------- reset chip ---------- */
 void OPLResetChip(FM_OPL *OPL)
 {
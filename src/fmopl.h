@@ -104,5 +104,6 @@ void OPLWrite(FM_OPL *OPL,int a,int v);
 unsigned char OPLRead(FM_OPL *OPL,int a);
 
 void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length);
+void YM3812UpdateRef(FM_OPL *OPL, INT16 *buffer, int length);
 
 #endif
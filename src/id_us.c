@@ -451,6 +451,7 @@ boolean US_LineInput(int x,int y,char *buf,const char *def,boolean escok,
 			USL_XORICursor(x,y,s,cursor);
 
 		VW_UpdateScreen();
+		IdleWait();
 	}
 
 	if (cursorvis)
@@ -505,3 +506,15 @@ int US_RndT()
 	rndindex &= 0xFF;
 	return rndtable[rndindex];
 }
+
+//	Get and set the position in the table, for world snapshots
+
+int US_GetRndT(void)
+{
+	return rndindex;
+}
+
+void US_SetRndT(int index)
+{
+	rndindex = index & 0xFF;
+}
@@ -35,5 +35,7 @@ void US_Startup(),
 boolean	US_LineInput(int x,int y,char *buf,const char *def,boolean escok,
 				int maxchars,int maxwidth);
 int				US_RndT();
+int				US_GetRndT(void);
+void			US_SetRndT(int index);
 
 #endif
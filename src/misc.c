@@ -9,35 +9,158 @@
 #define O_BINARY 0
 #endif
 
-static struct timeval t0;
-static unsigned long tc0;
+/* TimeCount runs off CLOCK_MONOTONIC, kept in nanoseconds so callers can */
+/* also get at the fraction of a tic, and so the tic epoch can be slept */
+/* against with clock_nanosleep(TIMER_ABSTIME) */
+
+/* A step of more than MAXCLOCKSTEP between two reads, or one backwards, */
+/* is taken out of the count as if the clock had stood still: a stopped */
+/* process, a stalled VM or a broken clock source then shows up as a */
+/* single long frame rather than a burst of tics */
+
+#define NSPERSEC	1000000000ll
+#define MAXCLOCKSTEP	NSPERSEC
+#define MAXSLEEP	(MAXCLOCKSTEP / 4)	/* keeps WaitTimeCount under it */
+
+static unsigned long tc0;	/* TimeCount at base */
+static int64_t base;		/* clock at tic tc0, jumps taken out */
+static int64_t lastclock;	/* clock at the last read */
+static int64_t clockskew;	/* SkewClock */
+
+static int64_t ReadClock(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	
+	return (int64_t)t.tv_sec * NSPERSEC + t.tv_nsec + clockskew;
+}
+
+/* nanoseconds since tic tc0 */
+
+static int64_t Elapsed(void)
+{
+	int64_t now, step;
+	
+	now = ReadClock();
+	step = now - lastclock;
+	if (step < 0 || step > MAXCLOCKSTEP)
+		base += step;
+	lastclock = now;
+	
+	return now - base;
+}
 
 void set_TimeCount(unsigned long t)
 {
 	tc0 = t;
 	
-	gettimeofday(&t0, NULL);
+	base = lastclock = ReadClock();
 }
 
 unsigned long get_TimeCount(void)
 {
-	struct timeval t1;
-	long secs, usecs;
-	unsigned long tc;
+	return tc0 + Elapsed() * 70 / NSPERSEC;
+}
+
+/*
+==================
+=
+= get_TimeCountFrac
+=
+= TimeCount, with how far into that tic the clock is in *frac (0 - 0xffff)
+=
+==================
+*/
+
+unsigned long get_TimeCountFrac(unsigned *frac)
+{
+	int64_t t;
 	
-	gettimeofday(&t1, NULL);
+	t = Elapsed() * 70;
+	*frac = (t % NSPERSEC) * 0x10000 / NSPERSEC;
+	
+	return tc0 + t / NSPERSEC;
+}
 
-	secs = t1.tv_sec - t0.tv_sec;
-	usecs = t1.tv_usec - t0.tv_usec;
+/*
+==================
+=
+= get_TimeStamp
+=
+= Raw monotonic microseconds, for stamping events.  Unlike get_TimeCount
+= this touches no shared state, so any thread may call it
+=
+==================
+*/
+
+unsigned long get_TimeStamp(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	
+	return t.tv_sec * 1000000ul + t.tv_nsec / 1000;
+}
 
-	if (usecs < 0) {
-		usecs += 1000000;
-		secs--;
+/*
+==================
+=
+= WaitTimeCount
+=
+= Sleeps until get_TimeCount() reaches tc, instead of spinning on it
+=
+==================
+*/
+
+void WaitTimeCount(unsigned long tc)
+{
+	struct timespec t;
+	int64_t wake;
+	
+	while ((long)(tc - get_TimeCount()) > 0) {
+		/* round up, so the tic has really started on waking */
+		wake = base + ((int64_t)(long)(tc - tc0) * NSPERSEC + 69) / 70;
+		if (wake - lastclock > MAXSLEEP)
+			wake = lastclock + MAXSLEEP;
+		wake -= clockskew;
+		
+		t.tv_sec = wake / NSPERSEC;
+		t.tv_nsec = wake % NSPERSEC;
+		
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
 	}
+}
 
-	tc = tc0 + secs * 70 + (usecs * 70) / 1000000;
-		
-	return tc;
+/*
+==================
+=
+= IdleWait
+=
+= Gives up the rest of the current tic; for loops that only poll input
+= (menus, intermission screens, "press a key")
+=
+==================
+*/
+
+void IdleWait(void)
+{
+	WaitTimeCount(get_TimeCount() + 1);
+}
+
+/*
+==================
+=
+= SkewClock
+=
+= Steps the clock TimeCount reads by secs, for testing the jump handling
+=
+==================
+*/
+
+void SkewClock(long secs)
+{
+	clockskew += (int64_t)secs * NSPERSEC;
 }
 
 long filelength(int handle)
@@ -232,9 +355,14 @@ int OpenWriteAppend(const char *fn)
 	return fp;
 }
 
-void CloseWrite(int fp)
+int CloseWrite(int fp)
 {
-	close(fp);
+	return close(fp);
+}
+
+int SyncWrite(int fp)
+{
+	return fsync(fp);
 }
 
 int WriteSeek(int fp, int offset, int whence)
@@ -327,3 +455,212 @@ int ReadBytes(int fp, byte *d, int len)
 {
 	return read(fp, d, len);
 }
+
+/* ** */
+
+/* memory buffers: build or parse a whole file in memory, then move it */
+/* to/from disk with a single write() or read() */
+
+void MemOpenWrite(membuf_t *mb)
+{
+	mb->size = 4096;
+	mb->data = malloc(mb->size);
+	mb->pos = 0;
+	mb->error = (mb->data == NULL);
+}
+
+void MemOpenRead(membuf_t *mb, byte *data, int len)
+{
+	mb->data = data;
+	mb->size = len;
+	mb->pos = 0;
+	mb->error = 0;
+}
+
+void MemClose(membuf_t *mb)
+{
+	free(mb->data);
+	mb->data = NULL;
+	mb->size = mb->pos = 0;
+}
+
+static byte *MemReserve(membuf_t *mb, int len)
+{
+	byte *p;
+	
+	if (mb->error)
+		return NULL;
+		
+	if (mb->pos + len > mb->size) {
+		int size = mb->size;
+		
+		while (mb->pos + len > size)
+			size *= 2;
+			
+		p = realloc(mb->data, size);
+		if (p == NULL) {
+			mb->error = 1;
+			return NULL;
+		}
+		
+		mb->data = p;
+		mb->size = size;
+	}
+	
+	p = mb->data + mb->pos;
+	mb->pos += len;
+	
+	return p;
+}
+
+void MemWriteInt8(membuf_t *mb, int8_t d)
+{
+	byte *p = MemReserve(mb, 1);
+	
+	if (p)
+		p[0] = d;
+}
+
+void MemWriteInt16(membuf_t *mb, int16_t d)
+{
+	byte *p = MemReserve(mb, 2);
+	
+	if (p) {
+		p[0] = d & 0xFF;
+		p[1] = (d >> 8) & 0xFF;
+	}
+}
+
+void MemWriteInt32(membuf_t *mb, int32_t d)
+{
+	byte *p = MemReserve(mb, 4);
+	
+	if (p) {
+		p[0] = d & 0xFF;
+		p[1] = (d >> 8) & 0xFF;
+		p[2] = (d >> 16) & 0xFF;
+		p[3] = (d >> 24) & 0xFF;
+	}
+}
+
+void MemWriteBytes(membuf_t *mb, const byte *d, int len)
+{
+	byte *p = MemReserve(mb, len);
+	
+	if (p)
+		memcpy(p, d, len);
+}
+
+void MemWriteAt32(membuf_t *mb, int pos, int32_t d)
+{
+	int save = mb->pos;
+	
+	if (pos + 4 > mb->pos) {
+		mb->error = 1;
+		return;
+	}
+	
+	mb->pos = pos;
+	MemWriteInt32(mb, d);
+	mb->pos = save;
+}
+
+static byte *MemTake(membuf_t *mb, int len)
+{
+	byte *p;
+	
+	if (mb->error || len < 0 || mb->pos + len > mb->size) {
+		mb->error = 1;
+		return NULL;
+	}
+	
+	p = mb->data + mb->pos;
+	mb->pos += len;
+	
+	return p;
+}
+
+int8_t MemReadInt8(membuf_t *mb)
+{
+	byte *p = MemTake(mb, 1);
+	
+	return p ? (int8_t)p[0] : 0;
+}
+
+int16_t MemReadInt16(membuf_t *mb)
+{
+	byte *p = MemTake(mb, 2);
+	
+	return p ? (int16_t)(p[0] | (p[1] << 8)) : 0;
+}
+
+int32_t MemReadInt32(membuf_t *mb)
+{
+	byte *p = MemTake(mb, 4);
+	
+	return p ? (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) : 0;
+}
+
+int MemReadBytes(membuf_t *mb, byte *d, int len)
+{
+	byte *p = MemTake(mb, len);
+	
+	if (p == NULL)
+		return 0;
+		
+	memcpy(d, p, len);
+	return len;
+}
+
+/* read a whole file into a malloc'd buffer; returns its length or -1 */
+int ReadWholeFile(int fp, byte **data)
+{
+	int len, got;
+	
+	*data = NULL;
+	
+	len = ReadLength(fp);
+	if (len < 0)
+		return -1;
+		
+	*data = malloc(len ? len : 1);
+	if (*data == NULL)
+		return -1;
+		
+	ReadSeek(fp, 0, SEEK_SET);
+	got = read(fp, *data, len);
+	if (got != len) {
+		free(*data);
+		*data = NULL;
+		return -1;
+	}
+	
+	return len;
+}
+
+/* ** */
+
+static uint32_t crctable[256];
+static int crcready;
+
+uint32_t CalcCRC32(const byte *d, int len)
+{
+	uint32_t crc;
+	int i, j;
+	
+	if (!crcready) {
+		for (i = 0; i < 256; i++) {
+			crc = i;
+			for (j = 0; j < 8; j++)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+			crctable[i] = crc;
+		}
+		crcready = 1;
+	}
+	
+	crc = 0xFFFFFFFF;
+	for (i = 0; i < len; i++)
+		crc = crctable[(crc ^ d[i]) & 0xFF] ^ (crc >> 8);
+		
+	return crc ^ 0xFFFFFFFF;
+}
@@ -9,6 +9,11 @@ void SavePCXRGBToFile(const unsigned char *buf, int width, int height, const cha
 
 void set_TimeCount(unsigned long t);
 unsigned long get_TimeCount(void);
+unsigned long get_TimeCountFrac(unsigned *frac);
+unsigned long get_TimeStamp(void);
+void WaitTimeCount(unsigned long tc);
+void IdleWait(void);
+void SkewClock(long secs);
 
 long filelength(int handle);
 
@@ -31,7 +36,8 @@ uint32_t SwapInt32L(uint32_t i);
 
 extern int OpenWrite(const char *fn);
 extern int OpenWriteAppend(const char *fn);
-extern void CloseWrite(int fp);
+extern int CloseWrite(int fp);
+extern int SyncWrite(int fp);
 
 extern int WriteSeek(int fp, int offset, int whence);
 extern int WritePos(int fp);
@@ -52,6 +58,33 @@ extern int16_t ReadInt16(int fp);
 extern int32_t ReadInt32(int fp);
 extern int ReadBytes(int fp, byte *d, int len);
 
+typedef struct
+{
+	byte	*data;
+	int	size;
+	int	pos;
+	int	error;
+} membuf_t;
+
+extern void MemOpenWrite(membuf_t *mb);
+extern void MemOpenRead(membuf_t *mb, byte *data, int len);
+extern void MemClose(membuf_t *mb);
+
+extern void MemWriteInt8(membuf_t *mb, int8_t d);
+extern void MemWriteInt16(membuf_t *mb, int16_t d);
+extern void MemWriteInt32(membuf_t *mb, int32_t d);
+extern void MemWriteBytes(membuf_t *mb, const byte *d, int len);
+extern void MemWriteAt32(membuf_t *mb, int pos, int32_t d);
+
+extern int8_t MemReadInt8(membuf_t *mb);
+extern int16_t MemReadInt16(membuf_t *mb);
+extern int32_t MemReadInt32(membuf_t *mb);
+extern int MemReadBytes(membuf_t *mb, byte *d, int len);
+
+extern int ReadWholeFile(int fp, byte **data);
+
+extern uint32_t CalcCRC32(const byte *d, int len);
+
 
 static __inline__ uint16_t SwapInt16(uint16_t i)
 {
@@ -1,5 +1,12 @@
 #include "wl_def.h"
 
+/* filled in by the sound thread, if there is one */
+unsigned long sndunderruns;	/* buffers the output ran dry before */
+unsigned long sndlatency;	/* worst us from command to speaker */
+
+/* -timedemo with -wavout or -sndsink: sound is mixed by SD_RenderTics */
+boolean soundrender;
+
 /*
 =====================
 =
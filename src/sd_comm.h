@@ -41,4 +41,10 @@ void UpdateSoundLoc(fixed x, fixed y, int angle);
 extern int DigiMap[];
 void InitDigiMap();
 
+extern unsigned long sndunderruns, sndlatency;
+extern boolean soundrender;
+
+void SD_RenderTics(int tics);
+void SD_OPLBench(void);
+
 #endif
@@ -0,0 +1,1755 @@
+/* the sound mixer and game side sound API, fed to the hardware by sd_oss.c */
+/* or sd_sdl.c */
+
+#include "wl_def.h"
+
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <stddef.h>
+
+/* TODO: this code is seriously braindead.  Needs to be rewritten.
+   Debug adlib sound issue with intel compiler
+ */
+                     
+#include "fmopl.h"
+#include "sd_mix.h"
+
+#define PACKED __attribute__((packed))
+
+typedef	struct {
+	longword length;
+	word priority;
+} PACKED SoundCommon;
+
+typedef	struct {
+	SoundCommon common;
+	byte data[1];
+} PACKED PCSound;
+
+typedef	struct {
+	byte mChar, cChar, mScale, cScale, mAttack, cAttack, mSus, cSus,
+		mWave, cWave, nConn, voice, mode, unused[3];
+} PACKED Instrument;
+
+typedef	struct {
+	SoundCommon common;
+	Instrument inst;
+	byte block, data[1];
+} PACKED AdLibSound;
+
+typedef	struct {
+	word length, values[1];
+} PACKED MusicGroup;
+
+typedef struct {
+	byte	*data;
+	int	length;			/* bytes left */
+	int	count;			/* ticks to the next write */
+} songreader_t;
+
+boolean AdLibPresent, SoundBlasterPresent;
+	
+SDMode SoundMode;
+SMMode MusicMode;
+SDSMode DigiMode;
+
+static word *DigiList;
+static int NumDigi;
+
+volatile boolean SD_Started;
+
+static FM_OPL *OPL;
+
+#define NUMVOICES	8
+#define OPLFRAMES	64		/* frames per AdLib tick */
+#define DIGIPHASES	63		/* 44100 / 7000 = 63 / 10 */
+#define DIGISTEPS	10
+#define DIGITAPS	16		/* input samples under the kernel */
+#define TICFRAMES	(44100/70)
+
+/*
+=============================================================================
+
+						COMMAND QUEUE
+
+ Everything the game side wants from the mixer goes through one single
+ producer, single consumer ring.  Each command is stamped with
+ get_TimeStamp when it is sent, or with renderframes when soundrender has
+ the game thread mixing in step with a -timedemo.  The mixer takes the commands sent
+ before a buffer started while mixing that buffer, and places each one at
+ the point of the buffer that matches its stamp.  Sounds started a tic
+ apart therefore play a tic apart, however the threads are scheduled.
+ AdLib commands take effect at the next AdLib tick.
+
+ The mixer answers through the done fields.  A voice (or the AdLib
+ effect channel) is free again once its done matches the serial of the
+ last command sent to it.
+
+=============================================================================
+*/
+
+typedef enum {
+	sc_play,		/* voice, DigiList entry, position */
+	sc_stop,		/* every digitized voice */
+	sc_adlib,		/* AdLib sound effect */
+	sc_music,		/* music to start from the top */
+	sc_musicon,
+	sc_musicoff
+} sndcmd_e;
+
+typedef struct
+{
+	unsigned long	time;		/* get_TimeStamp (renderframes) when sent */
+	byte	cmd;
+	byte	voice;
+	byte	positioned;
+	word	volume;			/* 0 - 256 */
+	int	digi;			/* sc_play DigiList entry */
+	fixed	x, y;			/* sc_play, if positioned */
+	int	area;			/* of x, y, or -1 */
+	int	song;			/* sc_music */
+	longword	serial;
+	void	*data;			/* sc_adlib AdLibSound, sc_music MusicGroup */
+} sndcmd_t;
+
+#define CMDQUEUESIZE	256		/* power of two */
+
+static sndcmd_t cmdqueue[CMDQUEUESIZE];
+static unsigned cmdhead, cmdtail;
+
+static longword soundserial;
+
+/* game side view of the digitized voices */
+
+typedef struct
+{
+	int	sound;
+	word	priority;
+	longword	serial;		/* also its age */
+	longword	done;
+} voice_t;
+
+static voice_t voices[NUMVOICES];
+
+static int CurAdlib;
+static longword adlibserial, adlibdone;
+
+/*
+ Where the player is, for placing positioned voices.  UpdateSoundLoc
+ writes the slot the mixer isn't reading and then bumps listenerseq;
+ the mixer copies the current slot once a buffer, and again if the
+ sequence moved while it was copying.
+*/
+
+typedef struct
+{
+	fixed	x, y;
+	int	angle;
+	unsigned long long	areas;	/* areabyplayer, a bit per area */
+} listener_t;
+
+static listener_t listeners[2] = { { 0, 0, 0, ~0ull } };
+static unsigned listenerseq;
+
+/* digitized sounds, resampled to the output rate by SD_Startup */
+
+typedef struct
+{
+	const short	*pcm;
+	int	frames;
+} digi_t;
+
+static digi_t *digis;
+static short *digipcm;			/* all of them, back to back */
+static float digikernel[DIGIPHASES][DIGITAPS];
+
+/*
+=============================================================================
+
+						MUSIC CACHE
+
+ With -musiccache each song is rendered to mono PCM the first time it is
+ started, by MusicCacheThread on an OPL of its own.  The PCM goes into a
+ file named for a hash of the song, so later runs, and other copies of
+ the game on the same machine, just map it.  Until a song's PCM is
+ published the mixer plays the song on the OPL as before, and it
+ switches over the next time the song loops or starts.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	MusicGroup	*music;		/* own copy for MusicCacheThread */
+	int	size;
+	longword	hash;
+	boolean	wanted;
+	long	frames;
+	short	*pcm;			/* published last */
+} song_t;
+
+static boolean musiccache;
+static song_t songs[LASTMUSIC];
+
+static pthread_t hMusicThread;
+static boolean musicthread;
+static pthread_mutex_t songlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t songwake = PTHREAD_COND_INITIALIZER;
+
+/*
+=============================================================================
+
+						MIXER
+
+=============================================================================
+*/
+
+typedef struct
+{
+	boolean	playing;
+	longword	serial;
+	int	volume;
+	int	gl, gr;			/* 0 - 256 */
+	boolean	positioned, muffled;
+	fixed	x, y;
+	int	area;
+	int	lowpass;		/* last muffled sample */
+	const short	*pcm;
+	int	frames, pos;
+} mixvoice_t;
+
+static mixvoice_t mixvoices[NUMVOICES];
+
+static listener_t ear;
+
+unsigned long bufstart;
+static unsigned long lastbufstart;
+
+static unsigned long renderframes, rendertarget, renderusec;
+
+static int mixbuf[MIXFRAMES*2] __attribute__((aligned(16)));
+short int sndbuf[MIXFRAMES*2];
+static short int musbuf[MIXFRAMES];
+
+static boolean sqActive;
+static MusicGroup *Music;
+static int MusicSong;
+static short *MusicPCM;
+static long MusicPCMFrames, MusicPCMPos;
+static songreader_t MusicReader;
+
+static boolean AdlibPlaying;
+static longword AdlibSerial;
+static byte AdlibBlock;
+static byte *AdlibData;
+static int AdlibLength;
+
+/*
+==========================
+=
+= PeekCommand
+=
+= The next command, if it was sent before this buffer started
+=
+==========================
+*/
+
+static sndcmd_t *PeekCommand()
+{
+	sndcmd_t *c;
+
+	if (cmdtail == __atomic_load_n(&cmdhead, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	c = &cmdqueue[cmdtail & (CMDQUEUESIZE-1)];
+	if ((long)(c->time - bufstart) >= 0)
+		return NULL;
+
+	return c;
+}
+
+static void PopCommand()
+{
+	__atomic_store_n(&cmdtail, cmdtail+1, __ATOMIC_RELEASE);
+}
+
+/*
+==========================
+=
+= CommandOffset
+=
+= Maps the command's stamp from the last buffer period onto this buffer
+=
+==========================
+*/
+
+static int CommandOffset(sndcmd_t *c)
+{
+	long span, t;
+
+	span = bufstart - lastbufstart;
+	t = c->time - lastbufstart;
+	if (span <= 0 || t <= 0)
+		return 0;
+	if (t >= span)
+		return MIXFRAMES - 1;
+
+	return t * MIXFRAMES / span;
+}
+
+/*
+==========================
+=
+= StartAdlib
+=
+==========================
+*/
+
+#define alChar		0x20
+#define alScale		0x40
+#define alAttack	0x60
+#define alSus		0x80
+#define alFeedCon	0xC0
+#define alWave		0xE0
+
+static void StartAdlib(AdLibSound *AdlibSnd)
+{
+	Instrument *inst;
+
+	inst = (Instrument *)&AdlibSnd->inst;
+
+	OPLWrite(OPL, 0 + alChar, 0);
+	OPLWrite(OPL, 0 + alScale, 0);
+	OPLWrite(OPL, 0 + alAttack, 0);
+	OPLWrite(OPL, 0 + alSus, 0);
+	OPLWrite(OPL, 0 + alWave, 0);
+	OPLWrite(OPL, 3 + alChar, 0);
+	OPLWrite(OPL, 3 + alScale, 0);
+	OPLWrite(OPL, 3 + alAttack, 0);
+	OPLWrite(OPL, 3 + alSus, 0);
+	OPLWrite(OPL, 3 + alWave, 0);
+	OPLWrite(OPL, 0xA0, 0);
+	OPLWrite(OPL, 0xB0, 0);
+	
+	OPLWrite(OPL, 0 + alChar, inst->mChar);
+	OPLWrite(OPL, 0 + alScale, inst->mScale);
+	OPLWrite(OPL, 0 + alAttack, inst->mAttack);
+	OPLWrite(OPL, 0 + alSus, inst->mSus);
+	OPLWrite(OPL, 0 + alWave, inst->mWave);
+	OPLWrite(OPL, 3 + alChar, inst->cChar);
+	OPLWrite(OPL, 3 + alScale, inst->cScale);
+	OPLWrite(OPL, 3 + alAttack, inst->cAttack);
+	OPLWrite(OPL, 3 + alSus, inst->cSus);
+	OPLWrite(OPL, 3 + alWave, inst->cWave);
+
+	//OPLWrite(OPL, alFeedCon, inst->nConn);
+	OPLWrite(OPL, alFeedCon, 0);
+	
+	AdlibBlock = ((AdlibSnd->block & 7) << 2) | 0x20;
+	AdlibData = (byte *)&AdlibSnd->data;
+	AdlibLength = AdlibSnd->common.length*5;
+	//OPLWrite(OPL, 0xB0, AdlibBlock);
+	AdlibPlaying = true;
+}
+
+/*
+==========================
+=
+= SongRewind / SongNext
+=
+= A song is a list of register writes, each with the ticks to wait after
+= it, as little endian bytes.  Call SongNext once per tick until it says
+= no: each true is a write due now, and the false uses up the tick.
+=
+==========================
+*/
+
+static void SongRewind(songreader_t *r, MusicGroup *music)
+{
+	r->data = (byte *)music + offsetof(MusicGroup, values);
+	r->length = music->length;
+	r->count = 0;
+}
+
+static boolean SongNext(songreader_t *r, byte *reg, byte *val)
+{
+	if (r->count > 0 || r->length <= 0) {
+		r->count--;
+		return false;
+	}
+
+	*reg = r->data[0];
+	*val = r->data[1];
+	r->count = r->data[2] | (r->data[3] << 8);
+	r->data += 4;
+	r->length -= 4;
+
+	return true;
+}
+
+/*
+==========================
+=
+= StartSong
+=
+= Takes the music back to the top, playing it from its cached PCM if
+= that is ready
+=
+==========================
+*/
+
+static void StartSong()
+{
+	short *pcm;
+	int i;
+
+	SongRewind(&MusicReader, Music);
+
+	pcm = __atomic_load_n(&songs[MusicSong].pcm, __ATOMIC_ACQUIRE);
+	if (pcm == NULL) {
+		MusicPCM = NULL;
+		return;
+	}
+
+/* let go of anything the OPL was still playing for the music */
+	for (i = 1; i < 9; i++)
+		OPLWrite(OPL, 0xB0 + i, 0);
+
+	MusicPCM = pcm;
+	MusicPCMFrames = songs[MusicSong].frames;
+	MusicPCMPos = 0;
+}
+
+/*
+==========================
+=
+= OPLTick
+=
+= Feeds one tick of music and AdLib effect to the OPL
+=
+==========================
+*/
+
+static void OPLTick()
+{
+	byte reg, val;
+
+	if (sqActive && Music && MusicReader.length <= 0)
+		StartSong();
+
+	if (sqActive && Music && !MusicPCM)
+		while (SongNext(&MusicReader, &reg, &val))
+			OPLWrite(OPL, reg, val);
+
+	if (AdlibPlaying) {
+		if (AdlibLength == 0) {
+			//OPLWrite(OPL, 0xB0, AdlibBlock);
+		} else if (AdlibLength == -1) {
+			OPLWrite(OPL, 0xA0, 00);
+			OPLWrite(OPL, 0xB0, AdlibBlock);
+			AdlibPlaying = false;
+			__atomic_store_n(&adlibdone, AdlibSerial, __ATOMIC_RELEASE);
+		} else if ((AdlibLength % 5) == 0) {
+			OPLWrite(OPL, 0xA0, *AdlibData);
+			OPLWrite(OPL, 0xB0, AdlibBlock & ~2);
+			AdlibData++;
+		}
+		AdlibLength--;
+	}
+}
+
+/*
+==========================
+=
+= StopVoice
+=
+==========================
+*/
+
+static void StopVoice(int voice)
+{
+	mixvoice_t *v = &mixvoices[voice];
+
+	v->playing = false;
+	__atomic_store_n(&voices[voice].done, v->serial, __ATOMIC_RELEASE);
+}
+
+/*
+==========================
+=
+= ReadListener
+=
+==========================
+*/
+
+static void ReadListener()
+{
+	unsigned seq;
+
+	do {
+		seq = __atomic_load_n(&listenerseq, __ATOMIC_ACQUIRE);
+		ear = listeners[seq & 1];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (seq != __atomic_load_n(&listenerseq, __ATOMIC_RELAXED));
+}
+
+/*
+==========================
+=
+= PlaceVoice
+=
+= Sets a voice's gains from where it is relative to the listener.  Both
+= ears lose up to half over the first eight tiles, as the old JAB tables
+= did; the ear facing away loses the rest of that half as the sound moves
+= to the other side, less so the further off it is.  A sound from an area
+= the player isn't connected to drops a further quarter and is muffled.
+=
+==========================
+*/
+
+#define MUFFLE	8735		/* 1 kHz one pole low pass, of 65536 */
+
+static void PlaceVoice(mixvoice_t *v)
+{
+	double dx, dy, a, fwd, right, dist, pan, near, far;
+	boolean muffled;
+
+	if (!v->positioned) {
+		v->gl = v->gr = v->volume >> 1;
+		return;
+	}
+
+	dx = (double)(v->x - ear.x) / TILEGLOBAL;
+	dy = (double)(v->y - ear.y) / TILEGLOBAL;
+	a = ear.angle * M_PI / (ANGLES/2);
+	fwd = dx * cos(a) - dy * sin(a);
+	right = dy * cos(a) + dx * sin(a);
+
+	dist = sqrt(fwd * fwd + right * right);
+	pan = (dist > 0.01) ? right / dist : 0;
+
+	near = (dist < 8) ? dist : 8;		/* attenuation, 16ths */
+	far = near + fabs(pan) * (8 - near);
+
+	muffled = v->area >= 0 && !((ear.areas >> v->area) & 1);
+	if (muffled) {
+		near += 4;
+		far += 4;
+		if (!v->muffled)
+			v->lowpass = v->pcm[v->pos];
+	}
+	v->muffled = muffled;
+
+	if (pan >= 0) {
+		v->gl = (16 - far) * v->volume / 16;
+		v->gr = (16 - near) * v->volume / 16;
+	} else {
+		v->gl = (16 - near) * v->volume / 16;
+		v->gr = (16 - far) * v->volume / 16;
+	}
+}
+
+/*
+==========================
+=
+= RunCommand
+=
+==========================
+*/
+
+static void RunCommand(sndcmd_t *c)
+{
+	mixvoice_t *v;
+	int i;
+
+	switch (c->cmd) {
+	case sc_play:
+		v = &mixvoices[c->voice];
+		v->serial = c->serial;
+		v->volume = c->volume;
+		v->positioned = c->positioned;
+		v->x = c->x;
+		v->y = c->y;
+		v->area = c->area;
+		v->muffled = false;
+		v->pcm = digis[c->digi].pcm;
+		v->frames = digis[c->digi].frames;
+		v->pos = 0;
+		v->playing = true;
+		PlaceVoice(v);
+		break;
+
+	case sc_stop:
+		for (i = 0; i < NUMVOICES; i++)
+			if (mixvoices[i].playing)
+				StopVoice(i);
+		break;
+
+	case sc_adlib:
+		AdlibSerial = c->serial;
+		StartAdlib(c->data);
+		break;
+
+	case sc_music:
+		Music = c->data;
+		MusicSong = c->song;
+		MusicReader.length = 0;
+		sqActive = true;
+		break;
+
+	case sc_musicon:
+		sqActive = true;
+		break;
+
+	case sc_musicoff:
+		sqActive = false;
+		break;
+	}
+}
+
+/*
+==========================
+=
+= MixVoice
+=
+= Accumulates src into acc with the given left and right gains (0 - 256)
+=
+==========================
+*/
+
+static void MixVoice(int *acc, const short *src, int frames, int gl, int gr)
+{
+	int i;
+#ifdef __SSE2__
+	__m128i gain, s, a, lo, hi, *p;
+
+	gain = _mm_set_epi16(gr, gl, gr, gl, gr, gl, gr, gl);
+	p = (__m128i *)acc;
+	for (i = 0; i + 8 <= frames; i += 8, p += 4) {
+		s = _mm_loadu_si128((const __m128i *)&src[i]);
+
+		a = _mm_unpacklo_epi16(s, s);
+		lo = _mm_mullo_epi16(a, gain);
+		hi = _mm_mulhi_epi16(a, gain);
+		_mm_storeu_si128(&p[0], _mm_add_epi32(_mm_loadu_si128(&p[0]), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128(&p[1], _mm_add_epi32(_mm_loadu_si128(&p[1]), _mm_unpackhi_epi16(lo, hi)));
+
+		a = _mm_unpackhi_epi16(s, s);
+		lo = _mm_mullo_epi16(a, gain);
+		hi = _mm_mulhi_epi16(a, gain);
+		_mm_storeu_si128(&p[2], _mm_add_epi32(_mm_loadu_si128(&p[2]), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128(&p[3], _mm_add_epi32(_mm_loadu_si128(&p[3]), _mm_unpackhi_epi16(lo, hi)));
+	}
+#else
+	i = 0;
+#endif
+	for (; i < frames; i++) {
+		acc[i*2+0] += src[i] * gl;
+		acc[i*2+1] += src[i] * gr;
+	}
+}
+
+/*
+==========================
+=
+= MixMuffled
+=
+= MixVoice through the occlusion low pass
+=
+==========================
+*/
+
+static void MixMuffled(int *acc, const short *src, int frames, int gl, int gr, int *lowpass)
+{
+	int i, s;
+
+	s = *lowpass;
+	for (i = 0; i < frames; i++) {
+		s += (src[i] - s) * MUFFLE >> 16;
+		acc[i*2+0] += s * gl;
+		acc[i*2+1] += s * gr;
+	}
+	*lowpass = s;
+}
+
+/*
+==========================
+=
+= MixSpan
+=
+= Mixes every playing voice into mixbuf from frame from up to frame to
+=
+==========================
+*/
+
+static void MixSpan(int from, int to)
+{
+	mixvoice_t *v;
+	int i, n;
+
+	if (to <= from)
+		return;
+
+	for (i = 0; i < NUMVOICES; i++) {
+		v = &mixvoices[i];
+		if (!v->playing)
+			continue;
+
+		n = v->frames - v->pos;
+		if (n > to - from)
+			n = to - from;
+		if (v->muffled)
+			MixMuffled(&mixbuf[from*2], &v->pcm[v->pos], n, v->gl, v->gr, &v->lowpass);
+		else
+			MixVoice(&mixbuf[from*2], &v->pcm[v->pos], n, v->gl, v->gr);
+
+		v->pos += n;
+		if (v->pos == v->frames)
+			StopVoice(i);
+	}
+}
+
+/*
+==========================
+=
+= FinishMix
+=
+= Drops mixbuf over the music in musbuf and clips it into sndbuf
+=
+==========================
+*/
+
+static void FinishMix()
+{
+	int i;
+
+/* full gain is 256 and a lone centred voice sits at half of that, which */
+/* with the >> 9 gives the old samp/2 and samp/4 levels */
+#ifdef __SSE2__
+	for (i = 0; i < MIXFRAMES; i += 4) {
+		__m128i m, a, b;
+
+		m = _mm_loadl_epi64((__m128i *)&musbuf[i]);
+		m = _mm_unpacklo_epi16(m, m);
+		a = _mm_srai_epi32(_mm_load_si128((__m128i *)&mixbuf[i*2+0]), 9);
+		b = _mm_srai_epi32(_mm_load_si128((__m128i *)&mixbuf[i*2+4]), 9);
+		a = _mm_add_epi32(a, _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), m), 16));
+		b = _mm_add_epi32(b, _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), m), 16));
+		_mm_storeu_si128((__m128i *)&sndbuf[i*2], _mm_packs_epi32(a, b));
+	}
+#else
+	int n;
+
+	for (i = 0; i < MIXFRAMES*2; i++) {
+		n = (mixbuf[i] >> 9) + musbuf[i/2];
+		if (n > 32767)
+			n = 32767;
+		if (n < -32768)
+			n = -32768;
+		sndbuf[i] = n;
+	}
+#endif
+}
+
+/*
+==========================
+=
+= AddSongPCM
+=
+= Adds the cached music over the AdLib effects, looping at the end
+=
+==========================
+*/
+
+static void AddSongPCM(short int *buf, int frames)
+{
+	int i, n;
+
+	for (i = 0; i < frames; i++) {
+		n = buf[i] + MusicPCM[MusicPCMPos];
+		if (n > 32767)
+			n = 32767;
+		if (n < -32768)
+			n = -32768;
+		buf[i] = n;
+
+		if (++MusicPCMPos == MusicPCMFrames)
+			MusicPCMPos = 0;
+	}
+}
+
+/*
+==========================
+=
+= MixBuffer
+=
+= Runs the commands sent during the last buffer period at their offsets,
+= one AdLib tick at a time, and mixes the next MIXFRAMES into sndbuf.
+= start is when the buffer begins on the command clock: get_TimeStamp
+= time for an output that mixes as it plays, where it lands in the
+= device's stream for one that mixes several at once, or renderframes.
+=
+==========================
+*/
+
+void MixBuffer(unsigned long start)
+{
+	sndcmd_t *c;
+	int i, pos, at, end;
+
+	lastbufstart = bufstart;
+	bufstart = start;
+
+	memset(mixbuf, 0, sizeof(mixbuf));
+
+	ReadListener();
+	for (i = 0; i < NUMVOICES; i++)
+		if (mixvoices[i].playing && mixvoices[i].positioned)
+			PlaceVoice(&mixvoices[i]);
+
+	pos = 0;
+	for (end = OPLFRAMES; end <= MIXFRAMES; end += OPLFRAMES) {
+		while ((c = PeekCommand()) != NULL && (at = CommandOffset(c)) < end) {
+			MixSpan(pos, at);
+			if (at > pos)
+				pos = at;
+			RunCommand(c);
+			PopCommand();
+		}
+		MixSpan(pos, end);
+		pos = end;
+
+		OPLTick();
+		YM3812UpdateOne(OPL, &musbuf[end - OPLFRAMES], OPLFRAMES);
+		if (sqActive && MusicPCM)
+			AddSongPCM(&musbuf[end - OPLFRAMES], OPLFRAMES);
+	}
+
+	FinishMix();
+}
+
+/*
+==========================
+=
+= WavOpen
+=
+= A 44.1 kHz stereo WAV file for any output that wants one; the header
+= is written again with the real length on WavClose
+=
+==========================
+*/
+
+static FILE *wavfile;
+static longword wavframes;
+
+static void WavLong(longword l)
+{
+	fputc(l, wavfile);
+	fputc(l >> 8, wavfile);
+	fputc(l >> 16, wavfile);
+	fputc(l >> 24, wavfile);
+}
+
+static void WavHeader()
+{
+	fseek(wavfile, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, wavfile);
+	WavLong(36 + wavframes * 4);
+	fwrite("WAVEfmt ", 1, 8, wavfile);
+	WavLong(16);
+	WavLong(1 | (2 << 16));		/* PCM, stereo */
+	WavLong(44100);
+	WavLong(44100 * 4);
+	WavLong(4 | (16 << 16));	/* frame size, bits */
+	fwrite("data", 1, 4, wavfile);
+	WavLong(wavframes * 4);
+}
+
+boolean WavOpen(char *name)
+{
+	wavfile = fopen(name, "wb");
+	if (wavfile == NULL) {
+		perror(name);
+		return false;
+	}
+
+	wavframes = 0;
+	WavHeader();
+	return true;
+}
+
+void WavWrite(short *buf, int frames)
+{
+	byte out[MIXFRAMES*4];
+	int i;
+
+	for (i = 0; i < frames * 2; i++) {
+		out[i*2+0] = buf[i];
+		out[i*2+1] = buf[i] >> 8;
+	}
+	fwrite(out, 4, frames, wavfile);
+	wavframes += frames;
+}
+
+void WavClose()
+{
+	WavHeader();
+	fclose(wavfile);
+	wavfile = NULL;
+}
+
+/*
+==========================
+=
+= MixLatency
+=
+= An output reports each buffer it takes with how many frames it still
+= holds ahead of it.  sndlatency is the longest a command can have taken
+= to be heard since the debug overlay last looked: those frames, plus the
+= buffer itself, plus the one the command waited for.
+=
+==========================
+*/
+
+void MixLatency(long queued)
+{
+	unsigned long lag;
+
+	lag = (int64_t)(queued + 2 * MIXFRAMES) * 1000000 / 44100;
+	if (lag > sndlatency)
+		sndlatency = lag;
+}
+
+/*
+==========================
+=
+= SongFrames
+=
+= How long one pass through the song is, at OPLFRAMES per tick
+=
+==========================
+*/
+
+static long SongFrames(MusicGroup *music)
+{
+	songreader_t r;
+	long ticks;
+
+	ticks = 0;
+	SongRewind(&r, music);
+	for (; r.length > 0; r.data += 4, r.length -= 4)
+		ticks += r.data[2] | (r.data[3] << 8);
+
+	return ticks * OPLFRAMES;
+}
+
+/*
+==========================
+=
+= RenderSong
+=
+= Plays the song once through on a fresh OPL, exactly as OPLTick feeds it
+=
+==========================
+*/
+
+static short *RenderSong(MusicGroup *music, long frames)
+{
+	FM_OPL *chip;
+	short *pcm, *p;
+	songreader_t r;
+	byte reg, val;
+
+	pcm = malloc(frames * sizeof(short) + OPLFRAMES * sizeof(short));
+	if (pcm == NULL)
+		return NULL;
+
+	chip = OPLCreate(OPL_TYPE_YM3812, 3579545, 44100);
+	if (chip == NULL) {
+		free(pcm);
+		return NULL;
+	}
+	OPLWrite(chip, 0x01, 0x20);
+	OPLWrite(chip, 0x08, 0x00);
+
+	SongRewind(&r, music);
+	for (p = pcm; p < pcm + frames; p += OPLFRAMES) {
+		while (SongNext(&r, &reg, &val))
+			OPLWrite(chip, reg, val);
+		YM3812UpdateOne(chip, p, OPLFRAMES);
+	}
+
+	OPLDestroy(chip);
+
+	return pcm;
+}
+
+/*
+==========================
+=
+= PrepareSong
+=
+= Maps the song's cache file, or renders the song and writes one
+=
+==========================
+*/
+
+static void PrepareSong(int song)
+{
+	song_t *s = &songs[song];
+	char name[64], tmp[80];
+	struct stat st;
+	short *pcm;
+	long frames;
+	int fd;
+
+	frames = SongFrames(s->music);
+	if (frames == 0)
+		return;
+
+	sprintf(name, "music%02d.%08x.%s", song, (unsigned)s->hash, extension);
+
+	pcm = NULL;
+	fd = open(name, O_RDONLY);
+	if (fd != -1) {
+		if (fstat(fd, &st) == 0 && st.st_size == frames * sizeof(short)) {
+			pcm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (pcm == MAP_FAILED)
+				pcm = NULL;
+		}
+		close(fd);
+	}
+
+	if (pcm == NULL) {
+		pcm = RenderSong(s->music, frames);
+		if (pcm == NULL)
+			return;
+
+	/* written aside and renamed, so nobody maps half a file */
+		sprintf(tmp, "%s.%d", name, (int)getpid());
+		fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd != -1) {
+			if (write(fd, pcm, frames * sizeof(short)) == frames * sizeof(short)
+			&& close(fd) == 0)
+				rename(tmp, name);
+			else
+				unlink(tmp);
+		}
+	}
+
+	s->frames = frames;
+	__atomic_store_n(&s->pcm, pcm, __ATOMIC_RELEASE);
+}
+
+static void *MusicCacheThread(void *data)
+{
+	int i;
+
+	pthread_mutex_lock(&songlock);
+	while (SD_Started) {
+		for (i = 0; i < LASTMUSIC; i++)
+			if (songs[i].wanted)
+				break;
+		if (i == LASTMUSIC) {
+			pthread_cond_wait(&songwake, &songlock);
+			continue;
+		}
+
+		songs[i].wanted = false;
+		pthread_mutex_unlock(&songlock);
+		PrepareSong(i);
+		pthread_mutex_lock(&songlock);
+	}
+	pthread_mutex_unlock(&songlock);
+
+	return NULL;
+}
+
+/*
+==========================
+=
+= WantSong
+=
+= Asks for the song's PCM, if it isn't there yet.  A -timedemo prepares
+= it on the spot, so the render comes out the same every time.
+=
+==========================
+*/
+
+static void WantSong(int song)
+{
+	song_t *s = &songs[song];
+	MusicGroup *music;
+	byte *p;
+	int i;
+
+	if (__atomic_load_n(&s->pcm, __ATOMIC_ACQUIRE))
+		return;
+
+	if (s->music == NULL) {
+		music = (MusicGroup *)audiosegs[STARTMUSIC + song];
+		s->size = sizeof(word) + music->length;
+		s->music = malloc(s->size);
+		if (s->music == NULL)
+			return;
+		memcpy(s->music, music, s->size);
+
+		s->hash = 2166136261u;		/* FNV-1a */
+		for (p = (byte *)s->music, i = 0; i < s->size; i++)
+			s->hash = (s->hash ^ p[i]) * 16777619u;
+	}
+
+	if (soundrender) {
+		PrepareSong(song);
+		return;
+	}
+
+	pthread_mutex_lock(&songlock);
+	s->wanted = true;
+	pthread_cond_signal(&songwake);
+	pthread_mutex_unlock(&songlock);
+}
+
+static void Blah()
+{
+        memptr  list;
+        word    *p, pg;
+        int     i;
+
+        MM_GetPtr(&list,PMPageSize);
+        p = PM_GetPage(ChunksInFile - 1);
+        memcpy((void *)list,(void *)p,PMPageSize);
+        
+        pg = PMSoundStart;
+        for (i = 0;i < PMPageSize / (sizeof(word) * 2);i++,p += 2)
+        {
+                if (pg >= ChunksInFile - 1)
+                        break;
+                pg += (p[1] + (PMPageSize - 1)) / PMPageSize;
+        }
+        MM_GetPtr((memptr *)&DigiList, i * sizeof(word) * 2);
+        memcpy((void *)DigiList, (void *)list, i * sizeof(word) * 2);
+        MM_FreePtr(&list);        
+
+        NumDigi = i;
+}
+
+/*
+==========================
+=
+= InitDigiKernel
+=
+= Blackman windowed sinc taps for each of the 63 positions an output
+= sample can fall between two 7000 Hz input samples, cut off a little
+= under the input Nyquist and scaled to unity gain
+=
+==========================
+*/
+
+static void InitDigiKernel()
+{
+	double d, x, w, sum;
+	int p, j;
+
+	for (p = 0; p < DIGIPHASES; p++) {
+		sum = 0;
+		for (j = 0; j < DIGITAPS; j++) {
+			d = (j - (DIGITAPS/2 - 1)) - (double)p / DIGIPHASES;
+			x = M_PI * 0.9 * d;
+			w = 0.42 + 0.5 * cos(M_PI * d / (DIGITAPS/2))
+				+ 0.08 * cos(2 * M_PI * d / (DIGITAPS/2));
+			digikernel[p][j] = (x == 0 ? 1 : sin(x) / x) * w;
+			sum += digikernel[p][j];
+		}
+		for (j = 0; j < DIGITAPS; j++)
+			digikernel[p][j] /= sum;
+	}
+}
+
+/*
+==========================
+=
+= ResampleDigi
+=
+= Runs len 7000 Hz samples through the kernel into frames at the output
+= rate
+=
+==========================
+*/
+
+static void ResampleDigi(byte *raw, int len, short *out, int frames)
+{
+	float *k, sum;
+	int n, i, j, t;
+
+	for (n = 0; n < frames; n++) {
+		k = digikernel[(n * DIGISTEPS) % DIGIPHASES];
+		t = (n * DIGISTEPS) / DIGIPHASES - (DIGITAPS/2 - 1);
+
+		sum = 0;
+		for (j = 0; j < DIGITAPS; j++, t++)
+			if (t >= 0 && t < len)
+				sum += ((raw[t] << 8) - 32768) * k[j];
+
+		i = lrintf(sum);
+		if (i > 32767)
+			i = 32767;
+		if (i < -32768)
+			i = -32768;
+		out[n] = i;
+	}
+}
+
+/*
+==========================
+=
+= PrepareDigis
+=
+= Gathers every DigiList sound out of its VSWAP pages and resamples it
+= into one block at the output rate, each sound contiguous, before there
+= is anything to mix.  Each page is let go as soon as it is copied, so
+= the sound is only held once.  From then on the block is only read, so
+= the mixer never goes near the page manager or the allocator, and
+= starting a sound costs the game thread nothing either.
+=
+==========================
+*/
+
+static void PrepareDigis()
+{
+	byte *raw, *page;
+	short *out;
+	long total;
+	int i, p, len, maxlen;
+
+	total = maxlen = 0;
+	for (i = 0; i < NumDigi; i++) {
+		len = DigiList[(i * 2) + 1];
+		digis[i].frames = (len * DIGIPHASES + DIGISTEPS - 1) / DIGISTEPS;
+		total += digis[i].frames;
+		if (len > maxlen)
+			maxlen = len;
+	}
+
+	digipcm = malloc(total * sizeof(short));
+	raw = malloc(maxlen);
+	if (digipcm == NULL || raw == NULL)
+		Quit("PrepareDigis: Out of memory");
+
+	out = digipcm;
+	for (i = 0; i < NumDigi; i++) {
+		len = DigiList[(i * 2) + 1];
+		for (p = 0; p < len; p += PMPageSize) {
+			page = PM_GetSoundPage(DigiList[(i * 2) + 0] + p / PMPageSize);
+			memcpy(raw + p, page, (len - p < PMPageSize) ? len - p : PMPageSize);
+			PM_FreeSoundPage(DigiList[(i * 2) + 0] + p / PMPageSize);
+		}
+
+		ResampleDigi(raw, len, out, digis[i].frames);
+		digis[i].pcm = out;
+		out += digis[i].frames;
+	}
+
+	free(raw);
+}
+
+void SD_Startup()
+{
+	if (SD_Started)
+		return;
+
+	Blah();
+	
+	InitDigiMap();
+
+	digis = calloc(NumDigi, sizeof(digi_t));
+	if (digis == NULL)
+		Quit("SD_Startup: Out of memory");
+	InitDigiKernel();
+	PrepareDigis();
+	
+	OPL = OPLCreate(OPL_TYPE_YM3812, 3579545, 44100);
+	OPLWrite(OPL, 0x01, 0x20); /* Set WSE=1 */
+	OPLWrite(OPL, 0x08, 0x00); /* Set CSM=0 & SEL=0 */
+
+	musiccache = MS_CheckParm("musiccache");
+
+/* a -timedemo runs faster than real time, so it mixes from SD_RenderTics */
+	soundrender = timedemo;
+
+	CurAdlib = -1;
+	bufstart = get_TimeStamp();
+	
+	SD_Started = true;
+	if (!OutputOpen()) {
+		SD_Started = false;
+		return;
+	}
+
+	if (musiccache && !soundrender) {
+		musicthread = pthread_create(&hMusicThread, NULL, MusicCacheThread, NULL) == 0;
+		if (!musicthread) {
+			perror("pthread_create");
+			musiccache = false;
+		}
+	}
+}
+
+void SD_Shutdown()
+{
+	if (!SD_Started)
+		return;
+
+	SD_MusicOff();
+	SD_StopSound();
+
+	SD_Started = false;
+	if (soundrender)
+		printf("audio frames %lu usec %lu\n", renderframes, renderusec);
+
+	OutputClose();
+
+	if (musicthread) {
+		pthread_mutex_lock(&songlock);
+		pthread_cond_signal(&songwake);
+		pthread_mutex_unlock(&songlock);
+		pthread_join(hMusicThread, NULL);
+		musicthread = false;
+	}
+
+	free(digipcm);
+	free(digis);
+	digipcm = NULL;
+	digis = NULL;
+}
+
+/*
+==========================
+=
+= SD_RenderTics
+=
+= Mixes tics worth of sound straight into the output.  Commands are stamped
+= with renderframes, so a -timedemo sounds exactly the same on every run
+= however fast it goes.
+=
+==========================
+*/
+
+void SD_RenderTics(int tics)
+{
+	unsigned long t0;
+
+	if (!SD_Started || !soundrender)
+		return;
+
+	t0 = get_TimeStamp();
+
+	rendertarget += tics * TICFRAMES;
+	while (renderframes + MIXFRAMES <= rendertarget) {
+		MixBuffer(renderframes);
+		OutputRender(sndbuf, MIXFRAMES);
+		renderframes += MIXFRAMES;
+	}
+
+	renderusec += get_TimeStamp() - t0;
+}
+
+/*
+==========================
+=
+= SendCommand
+=
+= Stamps the command and queues it for the mixer, false if the queue is
+= full or sound isn't running
+=
+==========================
+*/
+
+static boolean SendCommand(sndcmd_t *c)
+{
+	unsigned head;
+
+	if (!SD_Started)
+		return false;
+
+	head = cmdhead;
+	if (head - __atomic_load_n(&cmdtail, __ATOMIC_ACQUIRE) == CMDQUEUESIZE)
+		return false;
+
+	c->time = soundrender ? renderframes : get_TimeStamp();
+	cmdqueue[head & (CMDQUEUESIZE-1)] = *c;
+	__atomic_store_n(&cmdhead, head+1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static boolean VoiceBusy(voice_t *v)
+{
+	return v->serial != __atomic_load_n(&v->done, __ATOMIC_ACQUIRE);
+}
+
+/*
+==========================
+=
+= AreaAt
+=
+= The area whose floor gx, gy is on, or -1 for a door or anything else
+= that isn't floor
+=
+==========================
+*/
+
+static int AreaAt(fixed gx, fixed gy)
+{
+	int tx, ty;
+	word tile;
+
+	tx = gx >> TILESHIFT;
+	ty = gy >> TILESHIFT;
+	if (tx < 0 || tx >= MAPSIZE || ty < 0 || ty >= MAPSIZE)
+		return -1;
+
+	tile = *(mapsegs[0] + farmapylookup[ty] + tx);
+	if (tile < AREATILE || tile >= AREATILE + NUMAREAS)
+		return -1;
+
+	return tile - AREATILE;
+}
+
+/*
+==========================
+=
+= StartDigi
+=
+= Finds the sound a voice: a free one if there is one, otherwise the
+= lowest priority voice not above the new sound, oldest first
+=
+==========================
+*/
+
+static boolean StartDigi(soundnames sound, boolean positioned, fixed gx, fixed gy)
+{
+	SoundCommon *s;
+	voice_t *v, *best;
+	sndcmd_t c;
+
+	s = (SoundCommon *)audiosegs[STARTADLIBSOUNDS + sound];
+
+	best = NULL;
+	for (v = voices; v < &voices[NUMVOICES]; v++) {
+		if (!VoiceBusy(v)) {
+			best = v;
+			break;
+		}
+		if (v->priority > s->priority)
+			continue;
+		if (best == NULL || v->priority < best->priority
+		|| (v->priority == best->priority && v->serial < best->serial))
+			best = v;
+	}
+	if (best == NULL)
+		return false;
+
+	c.cmd = sc_play;
+	c.voice = best - voices;
+	c.positioned = positioned;
+	c.x = gx;
+	c.y = gy;
+	c.area = positioned ? AreaAt(gx, gy) : -1;
+	c.volume = 256;
+	c.digi = DigiMap[sound];
+	c.serial = soundserial + 1;
+	if (!SendCommand(&c))
+		return false;
+
+	v = best;
+	v->sound = sound;
+	v->priority = s->priority;
+	v->serial = ++soundserial;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_PlaySound() - plays the specified sound on the appropriate hardware
+//
+///////////////////////////////////////////////////////////////////////////
+boolean SD_PlaySound(soundnames sound)
+{
+	SoundCommon *s;
+	sndcmd_t c;
+	
+	if (!SD_Started)
+		return false;
+
+	if (DigiMap[sound] != -1)
+		return StartDigi(sound, false, 0, 0);
+	
+	s = (SoundCommon *)audiosegs[STARTADLIBSOUNDS + sound];
+
+	if ((adlibserial == __atomic_load_n(&adlibdone, __ATOMIC_ACQUIRE)) || (CurAdlib == -1) || 
+	(s->priority >= ((SoundCommon *)audiosegs[STARTADLIBSOUNDS+CurAdlib])->priority) ) {
+		c.cmd = sc_adlib;
+		c.data = s;
+		c.serial = soundserial + 1;
+		if (!SendCommand(&c))
+			return false;
+		adlibserial = ++soundserial;
+		CurAdlib = sound;
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_SoundPlaying() - returns the sound number that's playing, or 0 if
+//		no sound is playing
+//
+///////////////////////////////////////////////////////////////////////////
+word SD_SoundPlaying()
+{
+	voice_t *v, *newest;
+
+	newest = NULL;
+	for (v = voices; v < &voices[NUMVOICES]; v++)
+		if (VoiceBusy(v) && (newest == NULL || v->serial > newest->serial))
+			newest = v;
+	if (newest)
+		return newest->sound;
+	if (adlibserial != __atomic_load_n(&adlibdone, __ATOMIC_ACQUIRE))
+		return CurAdlib;
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_StopSound() - if a sound is playing, stops it
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_StopSound()
+{
+	sndcmd_t c;
+
+	c.cmd = sc_stop;
+	SendCommand(&c);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_WaitSoundDone() - waits until the current sound is done playing
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_WaitSoundDone()
+{
+	while (SD_SoundPlaying())
+		if (soundrender)
+			SD_RenderTics(1);
+		else
+			IdleWait();
+}
+
+/*
+==========================
+=
+= PlaySoundLocGlobal - Plays the sound on a voice of its own, placed at
+=	gx, gy.  The mixer pans and attenuates it for wherever the player
+=	has got to on every buffer it mixes.
+=
+==========================
+*/
+
+void PlaySoundLocGlobal(word s, intptr_t id, fixed gx, fixed gy)
+{
+	if (!SD_Started || DigiMap[s] == -1) {
+		SD_PlaySound(s);
+		return;
+	}
+
+	StartDigi(s, true, gx, gy);
+}
+
+/*
+==========================
+=
+= UpdateSoundLoc - Hands the mixer where the player is and which areas
+=	are connected to theirs (from areabyplayer, which ConnectAreas keeps
+=	up from areaconnect as doors open and close)
+=
+==========================
+*/
+
+void UpdateSoundLoc(fixed x, fixed y, int angle)
+{
+	listener_t *l;
+	unsigned seq;
+	int i;
+
+	seq = listenerseq;
+	l = &listeners[(seq + 1) & 1];
+
+	l->x = x;
+	l->y = y;
+	l->angle = angle;
+	l->areas = 0;
+	for (i = 0; i < NUMAREAS; i++)
+		if (areabyplayer[i])
+			l->areas |= 1ull << i;
+
+	__atomic_store_n(&listenerseq, seq + 1, __ATOMIC_RELEASE);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_MusicOn() - turns on the sequencer
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_MusicOn()
+{
+	sndcmd_t c;
+
+	c.cmd = sc_musicon;
+	SendCommand(&c);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_MusicOff() - turns off the sequencer and any playing notes
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_MusicOff()
+{
+	sndcmd_t c;
+
+	c.cmd = sc_musicoff;
+	SendCommand(&c);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_StartMusic() - starts playing the music pointed to
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_StartMusic(int music)
+{
+	sndcmd_t c;
+
+	CA_CacheAudioChunk(STARTMUSIC + music);
+
+	if (musiccache && SD_Started)
+		WantSong(music);
+	
+	c.cmd = sc_music;
+	c.data = audiosegs[STARTMUSIC + music];
+	c.song = music;
+	SendCommand(&c);
+}
+
+/*
+==========================
+=
+= SD_OPLBench
+=
+= -oplbench plays every song once through on two chips, one on
+= YM3812UpdateRef and one on YM3812UpdateOne, prints how long each core
+= took and where they disagree, and quits
+=
+==========================
+*/
+
+void SD_OPLBench()
+{
+	FM_OPL *ref, *fast;
+	MusicGroup *music;
+	INT16 a[OPLFRAMES], b[OPLFRAMES];
+	songreader_t r;
+	byte reg, val;
+	int i, j;
+	long samples, mismatches, totalmismatches;
+	unsigned long t0, t1, t2, refusec, fastusec, totalref, totalfast;
+
+	totalmismatches = totalref = totalfast = 0;
+
+	for (i = 0; i < LASTMUSIC; i++) {
+		CA_CacheAudioChunk(STARTMUSIC + i);
+		music = (MusicGroup *)audiosegs[STARTMUSIC + i];
+
+		ref = OPLCreate(OPL_TYPE_YM3812, 3579545, 44100);
+		fast = OPLCreate(OPL_TYPE_YM3812, 3579545, 44100);
+		OPLWrite(ref, 0x01, 0x20);
+		OPLWrite(fast, 0x01, 0x20);
+
+		SongRewind(&r, music);
+		samples = mismatches = 0;
+		refusec = fastusec = 0;
+
+		while (r.length > 0) {
+			while (SongNext(&r, &reg, &val)) {
+				OPLWrite(ref, reg, val);
+				OPLWrite(fast, reg, val);
+			}
+
+			t0 = get_TimeStamp();
+			YM3812UpdateRef(ref, a, OPLFRAMES);
+			t1 = get_TimeStamp();
+			YM3812UpdateOne(fast, b, OPLFRAMES);
+			t2 = get_TimeStamp();
+
+			refusec += t1 - t0;
+			fastusec += t2 - t1;
+			for (j = 0; j < OPLFRAMES; j++)
+				mismatches += a[j] != b[j];
+			samples += OPLFRAMES;
+		}
+
+		printf("music %2d samples %8ld mismatches %6ld ref %7lu us fast %7lu us\n",
+			i, samples, mismatches, refusec, fastusec);
+
+		totalmismatches += mismatches;
+		totalref += refusec;
+		totalfast += fastusec;
+
+		OPLDestroy(ref);
+		OPLDestroy(fast);
+		CA_UnCacheAudioChunk(STARTMUSIC + i);
+	}
+
+	printf("total mismatches %ld ref %lu us fast %lu us\n",
+		totalmismatches, totalref, totalfast);
+
+	Quit(totalmismatches ? "-oplbench: the OPL cores disagree" : NULL);
+}
+
+void SD_SetDigiDevice(SDSMode mode)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_SetSoundMode() - Sets which sound hardware to use for sound effects
+//
+///////////////////////////////////////////////////////////////////////////
+boolean SD_SetSoundMode(SDMode mode)
+{
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_SetMusicMode() - sets the device to use for background music
+//
+///////////////////////////////////////////////////////////////////////////
+boolean SD_SetMusicMode(SMMode mode)
+{
+	return false;
+}
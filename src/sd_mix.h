@@ -0,0 +1,27 @@
+#ifndef	__SD_MIX_H__
+#define	__SD_MIX_H__
+
+/* between the mixer in sd_mix.c and the output that plays what it mixes */
+
+#define MIXFRAMES	256		/* stereo frames per MixBuffer */
+
+extern volatile boolean SD_Started;
+
+extern short int sndbuf[MIXFRAMES*2];
+extern unsigned long bufstart;
+
+void MixBuffer(unsigned long start);
+void MixLatency(long queued);
+
+boolean WavOpen(char *name);
+void WavWrite(short *buf, int frames);
+void WavClose(void);
+
+/* each output provides these; with soundrender set there is no hardware */
+/* and the mix arrives through OutputRender instead */
+
+boolean OutputOpen(void);
+void OutputRender(short *buf, int frames);
+void OutputClose(void);
+
+#endif
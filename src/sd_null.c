@@ -43,9 +43,31 @@ void SD_Startup()
 	if (SD_Started)
 		return;
 	
+	if (MS_CheckParm("wavout") || MS_CheckParm("sndsink"))
+		Quit("-wavout/-sndsink: built without sound, link sd_oss.o or sd_sdl.o");
+
 	InitDigiMap();
 }
 
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_RenderTics() - mixes the sound for tics of a -timedemo
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_RenderTics(int tics)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	SD_OPLBench() - -oplbench needs the OPL emulator
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_OPLBench()
+{
+	Quit("-oplbench: built without sd_mix.o and fmopl.o");
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //
 //	SD_Shutdown() - shuts down the Sound Mgr
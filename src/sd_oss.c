@@ -1,638 +1,350 @@
+/* sound output through OSS, or paced into nothing or a WAV file, from a */
+/* thread of our own */
+
 #include "wl_def.h"
 
 #include <pthread.h>
 #include <sys/ioctl.h>
 #include <sys/soundcard.h>
 #include <sys/types.h>
-#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 
-/* TODO: this code is seriously braindead.  Needs to be rewritten.
-   Debug adlib sound issue with intel compiler
- */
-                     
-#include "fmopl.h"
-
-#define PACKED __attribute__((packed))
-
-typedef	struct {
-	longword length;
-	word priority;
-} PACKED SoundCommon;
-
-typedef	struct {
-	SoundCommon common;
-	byte data[1];
-} PACKED PCSound;
+#include "sd_mix.h"
 
-typedef	struct {
-	byte mChar, cChar, mScale, cScale, mAttack, cAttack, mSus, cSus,
-		mWave, cWave, nConn, voice, mode, unused[3];
-} PACKED Instrument;
-
-typedef	struct {
-	SoundCommon common;
-	Instrument inst;
-	byte block, data[1];
-} PACKED AdLibSound;
-
-typedef	struct {
-	word length, values[1];
-} PACKED MusicGroup;
-
-boolean AdLibPresent, SoundBlasterPresent;
-	
-SDMode SoundMode, MusicMode;
-SDSMode DigiMode;
-
-static volatile boolean sqActive;
-
-static fixed globalsoundx, globalsoundy;
-static int leftchannel, rightchannel;
-
-static volatile boolean SoundPositioned;
+static volatile int audiofd = -1;
 
-static word *DigiList;
+static pthread_t hSoundThread;
 
-static volatile boolean SD_Started;
-static volatile int audiofd = -1;
+/*
+=============================================================================
 
-static volatile int NextSound;
-static volatile int SoundPlaying;
-static volatile int SoundPlayPos;
-static volatile int SoundPlayLen;
-static volatile int SoundPage;
-static volatile int SoundLen;
-static volatile int L;
-static volatile int R;
-static byte *SoundData;
+						SINKS
 
-static FM_OPL *OPL;
+ Where the mixed buffers go.  queued says how many frames the sink holds
+ that haven't been heard yet, or -1 if it can't tell, in which case its
+ write is expected to block.  The null and WAV sinks have no hardware
+ behind them, so they pretend to drain at 44.1 kHz from when they were
+ opened.
 
-static MusicGroup *Music;
-static volatile int NewMusic;
+=============================================================================
+*/
 
-static volatile int NewAdlib;
-static volatile int AdlibPlaying;
+typedef struct
+{
+	char	*name;
+	boolean	(*open)(void);
+	long	(*queued)(void);
+	void	(*write)(short *buf, int frames);
+	void	(*close)(void);
+} sndsink_t;
 
-static pthread_t hSoundThread;
+static sndsink_t *sink;
 
-static int CurDigi;
-static int CurAdlib;
+static int sndperiods = 3;		/* MIXFRAMES buffers to keep queued */
 
-static boolean SPHack;
+static unsigned long pacestart;
+static long pacedframes;
 
-static short int sndbuf[512];
-static short int musbuf[256];
+static void PaceStart()
+{
+	pacestart = get_TimeStamp();
+	pacedframes = 0;
+}
 
-static void *SoundThread(void *data)
+static long PacedQueued()
 {
-	int i, snd;
-	short int samp;
-	int MusicLength;
-	int MusicCount;
-	word *MusicData;
-	word dat;
-	
-	AdLibSound *AdlibSnd;
-	byte AdlibBlock;
-	byte *AdlibData;
-	int AdlibLength;
-	Instrument *inst;
-	
-	MusicLength = 0;
-	MusicCount = 0;
-	MusicData = NULL;
-	AdlibBlock = 0;
-	AdlibData = NULL;
-	AdlibLength = -1;
+	unsigned long now;
+	long played;
 
-	OPLWrite(OPL, 0x01, 0x20); /* Set WSE=1 */
-	OPLWrite(OPL, 0x08, 0x00); /* Set CSM=0 & SEL=0 */
+	now = get_TimeStamp();
 
-/* Yeah, one day I'll rewrite this... */
-	
-	while (SD_Started) {
-		if (audiofd != -1) {
-			if (NewAdlib != -1) {
-				AdlibPlaying = NewAdlib;
-				AdlibSnd = (AdLibSound *)audiosegs[STARTADLIBSOUNDS+AdlibPlaying];
-				inst = (Instrument *)&AdlibSnd->inst;
-#define alChar		0x20
-#define alScale		0x40
-#define alAttack	0x60
-#define alSus		0x80
-#define alFeedCon	0xC0
-#define alWave		0xE0
-
-				OPLWrite(OPL, 0 + alChar, 0);
-				OPLWrite(OPL, 0 + alScale, 0);
-				OPLWrite(OPL, 0 + alAttack, 0);
-				OPLWrite(OPL, 0 + alSus, 0);
-				OPLWrite(OPL, 0 + alWave, 0);
-				OPLWrite(OPL, 3 + alChar, 0);
-				OPLWrite(OPL, 3 + alScale, 0);
-				OPLWrite(OPL, 3 + alAttack, 0);
-				OPLWrite(OPL, 3 + alSus, 0);
-				OPLWrite(OPL, 3 + alWave, 0);
-				OPLWrite(OPL, 0xA0, 0);
-				OPLWrite(OPL, 0xB0, 0);
-				
-				OPLWrite(OPL, 0 + alChar, inst->mChar);
-				OPLWrite(OPL, 0 + alScale, inst->mScale);
-				OPLWrite(OPL, 0 + alAttack, inst->mAttack);
-				OPLWrite(OPL, 0 + alSus, inst->mSus);
-				OPLWrite(OPL, 0 + alWave, inst->mWave);
-				OPLWrite(OPL, 3 + alChar, inst->cChar);
-				OPLWrite(OPL, 3 + alScale, inst->cScale);
-				OPLWrite(OPL, 3 + alAttack, inst->cAttack);
-				OPLWrite(OPL, 3 + alSus, inst->cSus);
-				OPLWrite(OPL, 3 + alWave, inst->cWave);
-
-				//OPLWrite(OPL, alFeedCon, inst->nConn);
-				OPLWrite(OPL, alFeedCon, 0);
-				
-				AdlibBlock = ((AdlibSnd->block & 7) << 2) | 0x20;
-				AdlibData = (byte *)&AdlibSnd->data;
-				AdlibLength = AdlibSnd->common.length*5;
-				//OPLWrite(OPL, 0xB0, AdlibBlock);
-				NewAdlib = -1;
-			}
-			
-			if (NewMusic != -1) {
-				NewMusic = -1;
-				MusicLength = Music->length;
-				MusicData = Music->values;
-				MusicCount = 0;
-			}
-			for (i = 0; i < 4; i++) {
-				if (sqActive) {
-					while (MusicCount <= 0) {
-						dat = *MusicData++;
-						MusicCount = *MusicData++;
-						MusicLength -= 4;
-						OPLWrite(OPL, dat & 0xFF, dat >> 8);
-					}
-					if (MusicLength <= 0) {
-						NewMusic = 1;
-					}
-					MusicCount--;
-				}
-
-				if (AdlibPlaying != -1) {
-					if (AdlibLength == 0) {
-						//OPLWrite(OPL, 0xB0, AdlibBlock);
-					} else if (AdlibLength == -1) {
-						OPLWrite(OPL, 0xA0, 00);
-						OPLWrite(OPL, 0xB0, AdlibBlock);
-						AdlibPlaying = -1;
-					} else if ((AdlibLength % 5) == 0) {
-						OPLWrite(OPL, 0xA0, *AdlibData);
-						OPLWrite(OPL, 0xB0, AdlibBlock & ~2);
-						AdlibData++;
-					}
-					AdlibLength--;
-				}
-
-				YM3812UpdateOne(OPL, &musbuf[i*64], 64);
-			} 
-			if (NextSound != -1) {
-				SoundPlaying = NextSound;
-				SoundPage = DigiList[(SoundPlaying * 2) + 0];
-				SoundData = PM_GetSoundPage(SoundPage);
-				SoundLen = DigiList[(SoundPlaying * 2) + 1];
-				SoundPlayLen = (SoundLen < 4096) ? SoundLen : 4096;
-				SoundPlayPos = 0;
-				NextSound = -1;
-			}
-			for (i = 0; i < (sizeof(sndbuf)/sizeof(sndbuf[0])); i += 2) {
-				if (SoundPlaying != -1) {
-					if (SoundPositioned) {
-						samp = (SoundData[(SoundPlayPos >> 16)] << 8)^0x8000;
-						snd = samp*(16-L)/32+musbuf[i/2];
-						//snd = (((signed short)((SoundData[(SoundPlayPos >> 16)] << 8)^0x8000))*(16-L)>>5)+musbuf[i/2];
-						if (snd > 32767)
-							snd = 32767;
-						if (snd < -32768)
-							snd = -32768;
-						sndbuf[i+0] = snd;
-						samp = (SoundData[(SoundPlayPos >> 16)] << 8)^0x8000;
-						snd = samp*(16-R)/32+musbuf[i/2];
-						//snd = (((signed short)((SoundData[(SoundPlayPos >> 16)] << 8)^0x8000))*(16-R)>>5)+musbuf[i/2];
-						if (snd > 32767)
-							snd = 32767;
-						if (snd < -32768)
-							snd = -32768;
-						sndbuf[i+1] = snd;
-					} else {
-						snd = (((signed short)((SoundData[(SoundPlayPos >> 16)] << 8)^0x8000))>>2)+musbuf[i/2];
-						if (snd > 32767)
-							snd = 32767;
-						if (snd < -32768)
-							snd = -32768;
-						sndbuf[i+0] = snd;
-						snd = (((signed short)((SoundData[(SoundPlayPos >> 16)] << 8)^0x8000))>>2)+musbuf[i/2];
-						if (snd > 32767)
-							snd = 32767;
-						if (snd < -32768)
-							snd = -32768;
-						sndbuf[i+1] = snd;
-					}
-					SoundPlayPos += 10402; /* 7000 / 44100 * 65536 */
-					if ((SoundPlayPos >> 16) >= SoundPlayLen) {
-						//SoundPlayPos = 0;
-						SoundPlayPos -= (SoundPlayLen << 16);
-						SoundLen -= 4096;
-						SoundPlayLen = (SoundLen < 4096) ? SoundLen : 4096;
-						if (SoundLen <= 0) {
-							SoundPlaying = -1;
-							SoundPositioned = false;
-						} else {
-							SoundPage++;
-							SoundData = PM_GetSoundPage(SoundPage);
-						}
-					}
-				} else {
-					sndbuf[i+0] = musbuf[i/2];
-					sndbuf[i+1] = musbuf[i/2];
-				}
-			}
-			write(audiofd, sndbuf, sizeof(sndbuf));
-		}		
+/* move the clock up a second at a time, so a sink that never runs dry */
+/* keeps its sums well inside 32 bits */
+	while (now - pacestart >= 1000000) {
+		pacestart += 1000000;
+		pacedframes -= 44100;
 	}
-	return NULL;
-}
 
-static void Blah()
-{
-        memptr  list;
-        word    *p, pg;
-        int     i;
-
-        MM_GetPtr(&list,PMPageSize);
-        p = PM_GetPage(ChunksInFile - 1);
-        memcpy((void *)list,(void *)p,PMPageSize);
-        
-        pg = PMSoundStart;
-        for (i = 0;i < PMPageSize / (sizeof(word) * 2);i++,p += 2)
-        {
-                if (pg >= ChunksInFile - 1)
-                        break;
-                pg += (p[1] + (PMPageSize - 1)) / PMPageSize;
-        }
-        MM_GetPtr((memptr *)&DigiList, i * sizeof(word) * 2);
-        memcpy((void *)DigiList, (void *)list, i * sizeof(word) * 2);
-        MM_FreePtr(&list);        
+	played = (now - pacestart) * 441 / 10000;
+	if (played >= pacedframes) {
+	/* ran dry, start the clock again from here */
+		PaceStart();
+		return 0;
+	}
+
+	return pacedframes - played;
 }
 
-void SD_Startup()
+/* OSS */
+
+static boolean OSSOpen()
 {
 	audio_buf_info info;
 	int want, set;
-	
-	if (SD_Started)
-		return;
 
-	Blah();
-	
-	InitDigiMap();
-	
-	OPL = OPLCreate(OPL_TYPE_YM3812, 3579545, 44100);
-	
 	audiofd = open("/dev/dsp", O_WRONLY);
 	if (audiofd == -1) {
 		perror("open(\"/dev/dsp\")");
-		return;
+		return false;
 	}
 	
-	set = (8 << 16) | 10;
+	set = ((sndperiods + 2) << 16) | 10;	/* MIXFRAMES per fragment */
 	if (ioctl(audiofd, SNDCTL_DSP_SETFRAGMENT, &set) == -1) {
 		perror("ioctl SNDCTL_DSP_SETFRAGMENT");
-		return;
+		goto fail;
 	}
 	
 	want = set = AFMT_S16_LE;
 	if (ioctl(audiofd, SNDCTL_DSP_SETFMT, &set) == -1) {
 		perror("ioctl SNDCTL_DSP_SETFMT");
-		return;
+		goto fail;
 	}
 	if (want != set) {
 		fprintf(stderr, "Format: Wanted %d, Got %d\n", want, set);
-		return;
+		goto fail;
 	}
 	
 	want = set = 1;
 	if (ioctl(audiofd, SNDCTL_DSP_STEREO, &set) == -1) {
 		perror("ioctl SNDCTL_DSP_STEREO");
-		return;
+		goto fail;
 	}
 	if (want != set) {
 		fprintf(stderr, "Stereo: Wanted %d, Got %d\n", want, set);
-		return;
+		goto fail;
 	}
 	
 	want = set = 44100;
 	if (ioctl(audiofd, SNDCTL_DSP_SPEED, &set) == -1) {
 		perror("ioctl SNDCTL_DSP_SPEED");
-		return;
+		goto fail;
 	}
 	if (want != set) {
 		fprintf(stderr, "Speed: Wanted %d, Got %d\n", want, set);
-		return;
+		goto fail;
 	}
 	
 	if (ioctl(audiofd, SNDCTL_DSP_GETOSPACE, &info) == -1) {
 		perror("ioctl SNDCTL_DSP_GETOSPACE");
-		return;
+		goto fail;
 	}
 	printf("Fragments: %d\n", info.fragments);
 	printf("FragTotal: %d\n", info.fragstotal);
 	printf("Frag Size: %d\n", info.fragsize);
 	printf("Bytes    : %d\n", info.bytes);
-	
-	NextSound = -1;
-	SoundPlaying = -1;
-	CurDigi = -1;
-	CurAdlib = -1;
-	NewAdlib = -1;
-	NewMusic = -1;
-	AdlibPlaying = -1;
-	sqActive = false;
-	
-	SD_Started = true;
-	
-	if (pthread_create(&hSoundThread, NULL, SoundThread, NULL) != 0) {
-		SD_Started = false;
-		
-		perror("pthread_create");
-		return;
-	}
+
+	return true;
+
+fail:
+	close(audiofd);
+	audiofd = -1;
+	return false;
 }
 
-void SD_Shutdown()
+static long OSSQueued()
 {
-	if (!SD_Started)
-		return;
+	int delay;
 
-	SD_MusicOff();
-	SD_StopSound();
+	if (ioctl(audiofd, SNDCTL_DSP_GETODELAY, &delay) == -1)
+		return -1;
 
-	SD_Started = false;
-	
-	if (audiofd != -1)
-		close(audiofd);
-	audiofd = -1;
+	return delay / 4;
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_PlaySound() - plays the specified sound on the appropriate hardware
-//
-///////////////////////////////////////////////////////////////////////////
-boolean SD_PlaySound(soundnames sound)
+static void OSSWrite(short *buf, int frames)
 {
-	SoundCommon *s;
-	
-	s = (SoundCommon *)audiosegs[STARTADLIBSOUNDS + sound];
-
-	if (DigiMap[sound] != -1) {
-		if ((SoundPlaying == -1) || (CurDigi == -1) || 
-		(s->priority >= ((SoundCommon *)audiosegs[STARTADLIBSOUNDS+CurDigi])->priority) ) {
-			if (SPHack) {
-				SPHack = false;
-			} else {
-				SoundPositioned = false;
-			}
-			CurDigi = sound;
-			NextSound = DigiMap[sound];
-			return true;
-		}
-		return false;
+	char *p;
+	int left, n;
+
+	p = (char *)buf;
+	left = frames * 4;
+	while (left > 0) {
+		n = write(audiofd, p, left);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		p += n;
+		left -= n;
 	}
-	
-	if ((AdlibPlaying == -1) || (CurAdlib == -1) || 
-	(s->priority >= ((SoundCommon *)audiosegs[STARTADLIBSOUNDS+CurAdlib])->priority) ) {
-		CurAdlib = sound;
-		NewAdlib = sound;
-		return true;
-	}
-	return false;
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_SoundPlaying() - returns the sound number that's playing, or 0 if
-//		no sound is playing
-//
-///////////////////////////////////////////////////////////////////////////
-word SD_SoundPlaying()
+static void OSSClose()
 {
-	if (SoundPlaying != -1)
-		return CurDigi;
-	if (AdlibPlaying != -1)
-		return CurAdlib;
-	return 0;
+	close(audiofd);
+	audiofd = -1;
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_StopSound() - if a sound is playing, stops it
-//
-///////////////////////////////////////////////////////////////////////////
-void SD_StopSound()
+/* null */
+
+static boolean NullOpen()
 {
-	SoundPlaying = -1;
+	PaceStart();
+	return true;
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_WaitSoundDone() - waits until the current sound is done playing
-//
-///////////////////////////////////////////////////////////////////////////
-void SD_WaitSoundDone()
+static void NullWrite(short *buf, int frames)
 {
-	while (SD_SoundPlaying()) ;
+	pacedframes += frames;
 }
 
+static void NullClose()
+{
+}
+
+/* WAV file, -wavout <file> */
+
+static char *wavname = "wolf3d.wav";
+
+static boolean WavSinkOpen()
+{
+	if (!WavOpen(wavname))
+		return false;
+
+	PaceStart();
+	return true;
+}
+
+static void WavSinkWrite(short *buf, int frames)
+{
+	WavWrite(buf, frames);
+	pacedframes += frames;
+}
+
+static sndsink_t sinks[] = {
+	{ "oss", OSSOpen, OSSQueued, OSSWrite, OSSClose },
+	{ "null", NullOpen, PacedQueued, NullWrite, NullClose },
+	{ "wav", WavSinkOpen, PacedQueued, WavSinkWrite, WavClose },
+	{ NULL }
+};
+
 /*
 ==========================
 =
-= SetSoundLoc - Given the location of an object (in terms of global
-=	coordinates, held in globalsoundx and globalsoundy), munges the values
-=	for an approximate distance from the left and right ear, and puts
-=	those values into leftchannel and rightchannel.
-=
-= JAB
+= SleepFrames
 =
 ==========================
 */
 
-#define ATABLEMAX 15
-static const byte righttable[ATABLEMAX][ATABLEMAX * 2] = {
-{ 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 7, 7, 6, 0, 0, 0, 0, 0, 1, 3, 5, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 7, 6, 4, 0, 0, 0, 0, 0, 2, 4, 6, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 6, 6, 4, 1, 0, 0, 0, 1, 2, 4, 6, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 6, 5, 4, 2, 1, 0, 1, 2, 3, 5, 7, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 6, 5, 4, 3, 2, 2, 3, 3, 5, 6, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 6, 6, 5, 4, 4, 4, 4, 5, 6, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 6, 6, 5, 5, 5, 6, 6, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 6, 6, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8}
-};
-static const byte lefttable[ATABLEMAX][ATABLEMAX * 2] = {
-{ 8, 8, 8, 8, 8, 8, 8, 8, 5, 3, 1, 0, 0, 0, 0, 0, 6, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 6, 4, 2, 0, 0, 0, 0, 0, 4, 6, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 6, 4, 2, 1, 0, 0, 0, 1, 4, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 7, 5, 3, 2, 1, 0, 1, 2, 4, 5, 6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 6, 5, 3, 3, 2, 2, 3, 4, 5, 6, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 6, 5, 4, 4, 4, 4, 5, 6, 6, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 6, 6, 5, 5, 5, 6, 6, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 6, 6, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
-{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8}
-};
-
-static void SetSoundLoc(fixed gx, fixed gy)
+static void SleepFrames(long frames)
 {
-	fixed xt, yt;
-	int x, y;
-
-// translate point to view centered coordinates
-//
-	gx -= viewx;
-	gy -= viewy;
-
-//
-// calculate newx
-//
-	xt = FixedByFrac(gx,viewcos);
-	yt = FixedByFrac(gy,viewsin);
-	x = (xt - yt) >> TILESHIFT;
-
-//
-// calculate newy
-//
-	xt = FixedByFrac(gx,viewsin);
-	yt = FixedByFrac(gy,viewcos);
-	y = (yt + xt) >> TILESHIFT;
-
-	if (y >= ATABLEMAX)
-		y = ATABLEMAX - 1;
-	else if (y <= -ATABLEMAX)
-		y = -ATABLEMAX;
-	if (x < 0)
-		x = -x;
-	if (x >= ATABLEMAX)
-		x = ATABLEMAX - 1;
-
-	leftchannel  =  lefttable[x][y + ATABLEMAX];
-	rightchannel = righttable[x][y + ATABLEMAX];
+	struct timespec t;
+	int64_t ns;
+
+	ns = (int64_t)frames * 1000000000 / 44100;
+	if (ns < 1000000)
+		ns = 1000000;
+	t.tv_sec = ns / 1000000000;
+	t.tv_nsec = ns % 1000000000;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &t, NULL);
 }
 
 /*
 ==========================
 =
-= SetSoundLocGlobal - Sets up globalsoundx & globalsoundy and then calls
-=	UpdateSoundLoc() to transform that into relative channel volumes. Those
-=	values are then passed to the Sound Manager so that they'll be used for
-=	the next sound played (if possible).
+= SoundThread
+=
+= Keeps sndperiods buffers queued in the sink and sleeps until one of
+= them has played.  A sink that has gone dry since the last write counts
+= as an underrun.
 =
 ==========================
 */
 
-void PlaySoundLocGlobal(word s, intptr_t id, fixed gx, fixed gy)
+static void *SoundThread(void *data)
 {
-	SetSoundLoc(gx, gy);
-	
-	SPHack = true;
-	if (SD_PlaySound(s)) {
-		SoundPositioned = true;
-		L = leftchannel;
-		R = rightchannel;
-		globalsoundx = gx;
-		globalsoundy = gy;
+	boolean primed;
+	long queued;
+
+	primed = false;
+
+	while (SD_Started) {
+		queued = sink->queued();
+		if (queued >= sndperiods * MIXFRAMES) {
+			SleepFrames(queued - (sndperiods - 1) * MIXFRAMES);
+			continue;
+		}
+
+		if (queued == 0 && primed)
+			sndunderruns++;
+		if (queued < 0)
+			queued = 0;
+
+		MixBuffer(get_TimeStamp());
+		sink->write(sndbuf, MIXFRAMES);
+		primed = true;
+
+		MixLatency(queued);
 	}
+	return NULL;
 }
 
-void UpdateSoundLoc(fixed x, fixed y, int angle)
+/*
+==========================
+=
+= OutputOpen
+=
+==========================
+*/
+
+boolean OutputOpen()
 {
-	if (SoundPositioned)
-	{
-		SetSoundLoc(globalsoundx, globalsoundy);
-		L = leftchannel;
-		R = rightchannel;
+	int i;
+
+	i = MS_CheckParm("sndperiods");
+	if (i && i + 1 < _argc) {
+		sndperiods = atoi(_argv[i+1]);
+		if (sndperiods < 1)
+			sndperiods = 1;
+		if (sndperiods > 16)
+			sndperiods = 16;
 	}
-}
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_MusicOn() - turns on the sequencer
-//
-///////////////////////////////////////////////////////////////////////////
-void SD_MusicOn()
-{
-	sqActive = true;
-}
+	sink = &sinks[0];
+	i = MS_CheckParm("sndsink");
+	if (i && i + 1 < _argc) {
+		for (sink = sinks; sink->name; sink++)
+			if (!strcmp(sink->name, _argv[i+1]))
+				break;
+		if (sink->name == NULL) {
+			fprintf(stderr, "Unknown sound sink %s\n", _argv[i+1]);
+			return false;
+		}
+	}
+	i = MS_CheckParm("wavout");
+	if (i && i + 1 < _argc) {
+		wavname = _argv[i+1];
+		sink = &sinks[2];
+	}
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_MusicOff() - turns off the sequencer and any playing notes
-//
-///////////////////////////////////////////////////////////////////////////
-void SD_MusicOff()
-{
-	sqActive = false;
-}
+	if (!sink->open())
+		return false;
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_StartMusic() - starts playing the music pointed to
-//
-///////////////////////////////////////////////////////////////////////////
-void SD_StartMusic(int music)
-{
-	music += STARTMUSIC;
-	
-	CA_CacheAudioChunk(music);
+	if (soundrender)
+		return true;
 	
-	SD_MusicOff();
-	SD_MusicOn();
-	Music = (MusicGroup *)audiosegs[music];
-	NewMusic = 1;
-}
+	if (pthread_create(&hSoundThread, NULL, SoundThread, NULL) != 0) {
+		sink->close();
+		
+		perror("pthread_create");
+		return false;
+	}
 
-void SD_SetDigiDevice(SDSMode mode)
-{
+	return true;
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_SetSoundMode() - Sets which sound hardware to use for sound effects
-//
-///////////////////////////////////////////////////////////////////////////
-boolean SD_SetSoundMode(SDMode mode)
+void OutputRender(short *buf, int frames)
 {
-	return false;
+	sink->write(buf, frames);
 }
 
-///////////////////////////////////////////////////////////////////////////
-//
-//	SD_SetMusicMode() - sets the device to use for background music
-//
-///////////////////////////////////////////////////////////////////////////
-boolean SD_SetMusicMode(SMMode mode)
+void OutputClose()
 {
-	return false;
+	if (!soundrender)
+		pthread_join(hSoundThread, NULL);
+
+	sink->close();
 }
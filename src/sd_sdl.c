@@ -0,0 +1,138 @@
+/* sound output through an SDL audio callback */
+
+#include "wl_def.h"
+
+#include "SDL.h"
+
+#include "sd_mix.h"
+
+static int sndbuffer = 512;		/* frames per callback, -sndbuffer */
+static int sndpos = MIXFRAMES;		/* frames of sndbuf already played */
+static unsigned long lastcallback;
+
+static char *wavname;
+
+/*
+==========================
+=
+= AudioCallback
+=
+= Runs on SDL's audio thread.  It talks to the game only through the
+= mixer's command ring and listener, so it never takes a lock the game
+= thread could be holding, and the game never calls SDL_LockAudio.  A
+= callback arriving more than two buffers after the last counts as an
+= underrun.
+=
+==========================
+*/
+
+static void AudioCallback(void *userdata, Uint8 *stream, int len)
+{
+	short *out;
+	unsigned long now;
+	int frames, done, n;
+
+	if (!SD_Started) {
+		memset(stream, 0, len);
+		return;
+	}
+
+	now = get_TimeStamp();
+	if (lastcallback && now - lastcallback > 2 * sndbuffer * 10000ul / 441)
+		sndunderruns++;
+	lastcallback = now;
+
+/* the device holds about one more buffer ahead of this one */
+	frames = len / 4;
+	MixLatency(frames);
+
+/* each buffer is stamped with where it starts in this stream, so the */
+/* commands keep their spacing however many buffers one callback takes */
+	out = (short *)stream;
+	for (done = 0; done < frames; done += n) {
+		if (sndpos == MIXFRAMES) {
+			MixBuffer(now + done * 10000ul / 441);
+			sndpos = 0;
+		}
+
+		n = MIXFRAMES - sndpos;
+		if (n > frames - done)
+			n = frames - done;
+		memcpy(out, &sndbuf[sndpos*2], n * 4);
+
+		out += n * 2;
+		sndpos += n;
+	}
+}
+
+/*
+==========================
+=
+= OutputOpen
+=
+==========================
+*/
+
+boolean OutputOpen()
+{
+	SDL_AudioSpec spec;
+	int i, n;
+
+	i = MS_CheckParm("wavout");
+	if (i && i + 1 < _argc)
+		wavname = _argv[i+1];
+
+/* a -timedemo only ever goes to the WAV file, if there is one */
+	if (soundrender)
+		return wavname == NULL || WavOpen(wavname);
+
+	i = MS_CheckParm("sndbuffer");
+	if (i && i + 1 < _argc) {
+		n = atoi(_argv[i+1]);
+		for (sndbuffer = 64; sndbuffer < n && sndbuffer < 8192; sndbuffer <<= 1)
+			;
+	}
+
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+		fprintf(stderr, "SDL audio: %s\n", SDL_GetError());
+		return false;
+	}
+
+	spec.freq = 44100;
+	spec.format = AUDIO_S16SYS;
+	spec.channels = 2;
+	spec.samples = sndbuffer;
+	spec.callback = AudioCallback;
+	spec.userdata = NULL;
+
+/* no obtained spec: SDL converts to whatever the device wants */
+	if (SDL_OpenAudio(&spec, NULL) < 0) {
+		fprintf(stderr, "SDL audio: %s\n", SDL_GetError());
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+
+	sndpos = MIXFRAMES;
+	lastcallback = 0;
+	SDL_PauseAudio(0);
+
+	return true;
+}
+
+void OutputRender(short *buf, int frames)
+{
+	if (wavname)
+		WavWrite(buf, frames);
+}
+
+void OutputClose()
+{
+	if (soundrender) {
+		if (wavname)
+			WavClose();
+		return;
+	}
+
+	SDL_CloseAudio();
+	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
@@ -70,6 +70,24 @@ static	const Direction	DirTable[] =		// Quick lookup for total direction
 
 static boolean btnstate[8];
 
+//
+// key event queue: filled by the platform's input thread with IN_QueueKey,
+// emptied by the game thread with IN_DrainKeys.  One producer and one
+// consumer, so the two indices are all the locking it needs
+//
+#define	INQUEUESIZE	256		// power of two
+
+typedef struct {
+	unsigned long	time;
+	byte			code;
+	byte			press;
+} inevent_t;
+
+static	inevent_t	inqueue[INQUEUESIZE];
+static	unsigned	inhead, intail;
+
+unsigned long	inputlag;	// oldest event IN_DrainKeys has seen, in usecs
+
 void keyboard_handler(int code, int press)
 {
 	byte k, c = 0;
@@ -135,6 +153,7 @@ boolean IN_UserInput(longword delay)
 	do {
 		if (IN_CheckAck())
 			return true;
+		IdleWait();
 	} while ( (get_TimeCount() - lasttime) < delay );
 	
 	return false;
@@ -165,6 +184,68 @@ static void INL_ShutKbd(void)
 //
 //	INL_ShutMouse() - Cleans up after the mouse
 //
+///////////////////////////////////////////////////////////////////////////
+//
+//	IN_QueueKey() - Called from the input thread for each key event.
+//		Returns false if the queue is full and the event wasn't taken
+//
+///////////////////////////////////////////////////////////////////////////
+boolean IN_QueueKey(int code, int press)
+{
+	unsigned	head;
+	inevent_t	*ev;
+
+	head = inhead;
+	if (head - __atomic_load_n(&intail, __ATOMIC_ACQUIRE) == INQUEUESIZE)
+		return false;
+
+	ev = &inqueue[head & (INQUEUESIZE-1)];
+	ev->time = get_TimeStamp();
+	ev->code = code;
+	ev->press = press;
+
+	__atomic_store_n(&inhead, head+1, __ATOMIC_RELEASE);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	IN_DrainKeys() - Feeds the queued key events to keyboard_handler.  A key
+//		that went down and back up since the last drain is left down until
+//		the next one, so a tap shorter than a frame still gets seen
+//
+///////////////////////////////////////////////////////////////////////////
+void IN_DrainKeys(void)
+{
+	boolean		pressed[256];
+	unsigned	head, tail;
+	unsigned long	now, lag;
+	inevent_t	*ev;
+
+	memset(pressed, 0, sizeof(pressed));
+
+	tail = intail;
+	head = __atomic_load_n(&inhead, __ATOMIC_ACQUIRE);
+	now = get_TimeStamp();
+
+	for (;tail != head;tail++)
+	{
+		ev = &inqueue[tail & (INQUEUESIZE-1)];
+		if (!ev->press && pressed[ev->code])
+			break;
+		if (ev->press)
+			pressed[ev->code] = true;
+
+		lag = now - ev->time;
+		if (lag > inputlag)
+			inputlag = lag;
+
+		keyboard_handler(ev->code, ev->press);
+	}
+
+	__atomic_store_n(&intail, tail, __ATOMIC_RELEASE);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 static void INL_ShutMouse(void)
 {
@@ -376,5 +457,6 @@ void IN_Ack()
 {
 	IN_StartAck();
 
-	while(!IN_CheckAck()) ;
+	while(!IN_CheckAck())
+		IdleWait();
 }
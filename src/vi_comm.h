@@ -154,6 +154,11 @@ extern	ControlType	Controls[MaxPlayers];
 
 extern void INL_Update();
 
+extern unsigned long inputlag;
+
+boolean IN_QueueKey(int code, int press);
+void IN_DrainKeys(void);
+
 extern void IN_Startup(), IN_Shutdown(), IN_ClearKeysDown(),
 		IN_ReadControl(int,ControlInfo *),
 		IN_GetJoyAbs(word joy,word *xp,word *yp),
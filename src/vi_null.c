@@ -111,6 +111,7 @@ void VL_GetPalette(byte *palette)
 
 void INL_Update()
 {
+	IN_DrainKeys();
 }
 
 void IN_GetMouseDelta(int *dx, int *dy)
@@ -124,6 +125,26 @@ byte IN_MouseButtons()
 	return 0;
 }
 
+///////////////////////////////////////////////////////////////////////////
+//
+//	INL_StartJoy() - Detects & auto-configures the specified joystick
+//					The auto-config assumes the joystick is centered
+//
+///////////////////////////////////////////////////////////////////////////
+boolean INL_StartJoy(word joy)
+{
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	INL_ShutJoy() - Cleans up the joystick stuff
+//
+///////////////////////////////////////////////////////////////////////////
+void INL_ShutJoy(word joy)
+{
+}
+
 /*
 ===================
 =
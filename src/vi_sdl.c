@@ -39,6 +39,8 @@ int main (int argc, char *argv[])
 
 void DisplayTextSplash(byte *text);
 
+static int SDLCALL INL_EventFilter(const SDL_Event *event);
+
 /*
 ==========================
 =
@@ -75,8 +77,7 @@ void Quit(const char *error)
 
 void VL_WaitVBL(int vbls)
 {
-	unsigned long last = get_TimeCount() + vbls;
-	while (last > get_TimeCount()) ;
+	WaitTimeCount(get_TimeCount() + vbls);
 }
 
 void VW_UpdateScreen()
@@ -110,6 +111,11 @@ void VL_Startup()
 		vheight *= 3;
 	}
 	
+	/* have SDL gather events on a thread of its own where it can, so */
+	/* keys get queued (and stamped) as they happen, not once a frame */
+#ifdef _REENTRANT
+	if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_NOPARACHUTE|SDL_INIT_EVENTTHREAD) < 0)
+#endif
 	if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_NOPARACHUTE) < 0) {
 		Quit("Couldn't init SDL");
 	}
@@ -135,6 +141,8 @@ void VL_Startup()
 	SDL_WM_SetCaption(GAMENAME, GAMENAME);
 	
 	SDL_InitSubSystem(SDL_INIT_JOYSTICK);
+	
+	SDL_SetEventFilter(INL_EventFilter);
 }
 
 /*
@@ -353,6 +361,30 @@ static int XKeysymToScancode(unsigned int keysym)
 	}
 }
 
+/*
+=======================
+=
+= INL_EventFilter
+=
+= Runs on SDL's event thread (or inside SDL_PumpEvents without one) and
+= moves key events into the input queue.  Anything else, or a key that
+= doesn't fit, is left for INL_Update to pick up
+=
+=======================
+*/
+
+static int SDLCALL INL_EventFilter(const SDL_Event *event)
+{
+	switch(event->type) {
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			return !IN_QueueKey(XKeysymToScancode(event->key.keysym.sym),
+				event->type == SDL_KEYDOWN);
+		default:
+			return 1;
+	}
+}
+
 void INL_Update()
 {
 	SDL_Event event;
@@ -362,7 +394,12 @@ void INL_Update()
 	
 	/* poll joysticks */
 	SDL_JoystickUpdate();
-		
+	
+	/* does nothing if there's an event thread */
+	SDL_PumpEvents();
+	
+	IN_DrainKeys();
+	
 	if (SDL_PollEvent(&event)) {
 		do {
 			switch(event.type) {
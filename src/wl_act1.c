@@ -768,6 +768,7 @@ void PushWall(int checkx, int checky, int dir)
 	pwallpos = 0;
 	tilemap[pwallx][pwally] |= 0xc0;
 	*(mapsegs[1]+farmapylookup[pwally]+pwallx) = 0;	// remove P tile info
+	InvalidateSightCache();
 
 	SD_PlaySound(PUSHWALLSND);
 }
@@ -804,6 +805,7 @@ void MovePWalls()
 		tilemap[pwallx][pwally] = 0;
 		actorat[pwallx][pwally] = 0;
 		*(mapsegs[0]+farmapylookup[pwally]+pwallx) = player->areanumber+AREATILE;
+		InvalidateSightCache();
 
 		//
 		// see if it should be pushed farther
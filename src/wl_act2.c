@@ -828,7 +828,7 @@ void T_Bite (objtype *ob)
 void SpawnTrans (int tilex, int tiley)
 {
 	if (SoundBlasterPresent && DigiMode != sds_Off)
-		gamestates[s_transdie01].tictime = 105;
+		SetStateTics (s_transdie01,105);
 
 	SpawnNewObj(tilex,tiley,s_transstand);
 	new->obclass = transobj;
@@ -853,7 +853,7 @@ void SpawnTrans (int tilex, int tiley)
 void SpawnUber (int tilex, int tiley)
 {
 	if (SoundBlasterPresent && DigiMode != sds_Off)
-		gamestates[s_uberdie01].tictime = 70;
+		SetStateTics (s_uberdie01,70);
 
 	SpawnNewObj (tilex,tiley,s_uberstand);
 	new->obclass = uberobj;
@@ -895,7 +895,7 @@ void T_UShoot(objtype *ob)
 void SpawnWill(int tilex, int tiley)
 {
 	if (SoundBlasterPresent && DigiMode != sds_Off)
-		gamestates[s_willdie2].tictime = 70;
+		SetStateTics (s_willdie2,70);
 
 	SpawnNewObj (tilex,tiley,s_willstand);
 	new->obclass = willobj;
@@ -1011,7 +1011,7 @@ void T_Will(objtype *ob)
 void SpawnDeath(int tilex, int tiley)
 {
 	if (SoundBlasterPresent && DigiMode != sds_Off)
-		gamestates[s_deathdie2].tictime = 105;
+		SetStateTics (s_deathdie2,105);
 
 	SpawnNewObj (tilex,tiley,s_deathstand);
 	new->obclass = deathobj;
@@ -1111,7 +1111,7 @@ void A_Breathing(objtype *ob)
 void SpawnAngel(int tilex, int tiley)
 {
 	if (SoundBlasterPresent && DigiMode != sds_Off)
-		gamestates[s_angeldie11].tictime = 105;
+		SetStateTics (s_angeldie11,105);
 
 	SpawnNewObj (tilex,tiley,s_angelstand);
 	new->obclass = angelobj;
@@ -1337,9 +1337,9 @@ void SpawnGhosts (int which, int tilex, int tiley)
 void SpawnSchabbs(int tilex, int tiley)
 { 
 	if (DigiMode != sds_Off)
-		gamestates[s_schabbdie2].tictime = 140;
+		SetStateTics (s_schabbdie2,140);
 	else
-		gamestates[s_schabbdie2].tictime = 5;
+		SetStateTics (s_schabbdie2,5);
 
 	SpawnNewObj(tilex, tiley, s_schabbstand);
 	new->speed = SPDPATROL;
@@ -1364,9 +1364,9 @@ void SpawnSchabbs(int tilex, int tiley)
 void SpawnGift (int tilex, int tiley)
 {
 	if (DigiMode != sds_Off)
-		gamestates[s_giftdie2].tictime = 140;
+		SetStateTics (s_giftdie2,140);
 	else
-		gamestates[s_giftdie2].tictime = 5;
+		SetStateTics (s_giftdie2,5);
 
 	SpawnNewObj (tilex,tiley,s_giftstand);
 	new->speed = SPDPATROL;
@@ -1391,9 +1391,9 @@ void SpawnGift (int tilex, int tiley)
 void SpawnFat (int tilex, int tiley)
 {
 	if (DigiMode != sds_Off)
-		gamestates[s_fatdie2].tictime = 140;
+		SetStateTics (s_fatdie2,140);
 	else
-		gamestates[s_fatdie2].tictime = 5;
+		SetStateTics (s_fatdie2,5);
 
 	SpawnNewObj (tilex,tiley,s_fatstand);
 	new->speed = SPDPATROL;
@@ -1783,9 +1783,9 @@ void T_Fat (objtype *ob)
 void SpawnFakeHitler(int tilex, int tiley)
 {
 	if (DigiMode != sds_Off)
-		gamestates[s_hitlerdie2].tictime = 140;
+		SetStateTics (s_hitlerdie2,140);
 	else
-		gamestates[s_hitlerdie2].tictime = 5;
+		SetStateTics (s_hitlerdie2,5);
 
 	SpawnNewObj(tilex, tiley, s_fakestand);
 	new->speed = SPDPATROL;
@@ -1810,9 +1810,9 @@ void SpawnFakeHitler(int tilex, int tiley)
 void SpawnHitler(int tilex, int tiley)
 {
 	if (DigiMode != sds_Off)
-		gamestates[s_hitlerdie2].tictime = 140;
+		SetStateTics (s_hitlerdie2,140);
 	else
-		gamestates[s_hitlerdie2].tictime = 5;
+		SetStateTics (s_hitlerdie2,5);
 
 
 	SpawnNewObj (tilex,tiley,s_mechastand);
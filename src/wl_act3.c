@@ -636,3 +636,56 @@ statetype gamestates[MAXSTATES] = {
 /* s_attack */	{false,0,0,T_Attack,NULL, s_none}
 
 };
+
+statelink_t statelinks[MAXSTATES];
+
+/*
+===================
+=
+= InitStateLinks
+=
+= Builds the compact step table from gamestates
+=
+===================
+*/
+
+void InitStateLinks()
+{
+	int i;
+	statetype *state;
+	statelink_t *link;
+
+	for (i = 0; i < MAXSTATES; i++) {
+		state = &gamestates[i];
+		link = &statelinks[i];
+
+		link->next = state->next;
+		link->nexttics = gamestates[state->next].tictime;
+		link->flags = 0;
+		if (state->think)
+			link->flags |= SL_THINK;
+		if (state->action)
+			link->flags |= SL_ACTION;
+	}
+}
+
+/*
+===================
+=
+= SetStateTics
+=
+= Changes the length of a state, and every link that leads into it
+=
+===================
+*/
+
+void SetStateTics(int state, int tictime)
+{
+	int i;
+
+	gamestates[state].tictime = tictime;
+
+	for (i = 0; i < MAXSTATES; i++)
+		if (statelinks[i].next == state)
+			statelinks[i].nexttics = tictime;
+}
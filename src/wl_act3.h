@@ -619,4 +619,24 @@ typedef enum {
 
 extern statetype gamestates[MAXSTATES];
 
+//
+// what DoActor needs to step through the states, kept small so a pass over
+// all the actors stays in cache.  think and action are only fetched from
+// gamestates when the flag says there is one
+//
+#define SL_THINK	1
+#define SL_ACTION	2
+
+typedef struct
+{
+	short	next;			// stateenum
+	short	nexttics;		// tictime of next, 0 stops in it and thinks
+	byte	flags;
+} statelink_t;
+
+extern statelink_t statelinks[MAXSTATES];
+
+void InitStateLinks(void);
+void SetStateTics(int state, int tictime); /* stateenum */
+
 #endif
@@ -49,6 +49,111 @@ void CountObjects()
 	IN_Ack();
 }
 
+/*
+================
+=
+= DrawProfileOverlay
+=
+= Prints the sight cache counters over the play window every frame, the
+= longest a key event has sat in the input queue and the worst sound
+= latency since the last one, and the sound underruns so far
+=
+================
+*/
+
+void DrawProfileOverlay()
+{
+	long	traced;
+
+	fontnumber = 0;
+	SETFONTCOLOR(15,0);
+	WindowX = PrintX = 160-viewwidthwin/2+2;
+	PrintY = (200-STATUSLINES-viewheightwin)/2+2;
+
+	traced = sightchecks-sightculled-sightcached;
+
+	US_Print ("Sight checks:");
+	US_PrintUnsigned (sightchecks);
+	US_Print ("\nPVS culled  :");
+	US_PrintUnsigned (sightculled);
+	US_Print ("\nCache hits  :");
+	US_PrintUnsigned (sightcached);
+	US_Print ("\nPrechecked  :");
+	US_PrintUnsigned (sightprechecked);
+	US_Print ("\nTraced      :");
+	US_PrintUnsigned (traced);
+	US_Print ("\nHit rate %  :");
+	US_PrintUnsigned (sightchecks ? (sightculled+sightcached)*100/sightchecks : 0);
+	US_Print ("\nInput lag us:");
+	US_PrintUnsigned (inputlag);
+	inputlag = 0;
+	US_Print ("\nSound lag us:");
+	US_PrintUnsigned (sndlatency);
+	sndlatency = 0;
+	US_Print ("\nUnderruns   :");
+	US_PrintUnsigned (sndunderruns);
+}
+
+/*
+================
+=
+= ActorBenchmark
+=
+= Runs the actors (not the player) for ten seconds of game time without
+= drawing, and shows how long it took.  Best tried on a crowded level.
+= The world is put back the way it was afterwards
+=
+================
+*/
+
+#define BENCHTICS	(10*TickBase)
+
+static worldsnap_t benchsnap;
+
+void ActorBenchmark()
+{
+	unsigned long start;
+	long usecs;
+	int i, count, oldtics;
+	objtype *ob;
+
+	count = 0;
+	for (ob=player->next;ob;ob=ob->next)
+		count++;
+
+	SaveWorld(&benchsnap);
+	oldtics = tics;
+	tics = 1;
+
+	start = get_TimeStamp();
+	for (i=0;i<BENCHTICS && playstate == ex_stillplaying;i++)
+	{
+		MoveDoors();
+		MovePWalls();
+		PrecheckSight();
+		for (ob=player->next;ob;ob=ob->next)
+			DoActor(ob);
+		gamestate.TimeCount += tics;
+	}
+	usecs = get_TimeStamp() - start;
+
+	tics = oldtics;
+	playstate = ex_stillplaying;
+	RestoreWorld(&benchsnap);
+
+	CenterWindow (18,7);
+	US_Print ("Actors     :");
+	US_PrintUnsigned (count);
+	US_Print ("\nTics       :");
+	US_PrintUnsigned (i);
+	US_Print ("\nTotal ms   :");
+	US_PrintUnsigned (usecs/1000);
+	US_Print ("\nus per tic :");
+	US_PrintUnsigned (i ? usecs/i : 0);
+	VW_UpdateScreen();
+	IN_Ack();
+}
+
 /*
 ================
 =
@@ -90,6 +195,161 @@ void ShapeTest()
 {
 }
 
+/*
+================
+=
+= ClockTest
+=
+= -clocktest: steps the clock TimeCount reads back and forth to check that
+= the game never sees the jump, then that waits still keep time.  Needs no
+= game data; prints the results and exits
+=
+================
+*/
+
+static int clockfailures;
+
+static void ClockCheck(const char *what, boolean ok)
+{
+	printf("clocktest: %-36s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok)
+		clockfailures++;
+}
+
+void ClockTest()
+{
+	struct timespec start, end;
+	unsigned long tc, now, last;
+	unsigned frac, lastfrac;
+	long ms;
+	boolean ok;
+
+	set_TimeCount(0);
+
+	tc = get_TimeCount();
+	SkewClock(3600);
+	now = get_TimeCount();
+	ClockCheck("clock an hour forward", now - tc <= 1);
+
+	tc = now;
+	SkewClock(-2*3600);
+	now = get_TimeCount();
+	ClockCheck("clock two hours back", now >= tc && now - tc <= 1);
+	SkewClock(3600);
+
+	ok = true;
+	tc = last = get_TimeCountFrac(&lastfrac);
+	while (last < tc+3)
+	{
+		now = get_TimeCountFrac(&frac);
+		if (frac > 0xffff || now < last || (now == last && frac < lastfrac))
+			ok = false;
+		last = now;
+		lastfrac = frac;
+	}
+	ClockCheck("tic fraction counts up", ok);
+
+	// longer than a jump, so this also covers the sleep being split up
+	tc = get_TimeCount();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	WaitTimeCount(tc+2*TickBase);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	now = get_TimeCount();
+	ms = (end.tv_sec-start.tv_sec)*1000 + (end.tv_nsec-start.tv_nsec)/1000000;
+	ClockCheck("two second wait", now >= tc+2*TickBase && now <= tc+2*TickBase+1
+		&& ms >= 1985 && ms < 2100);
+
+	lasttimecount = get_TimeCount();
+	SkewClock(600);
+	CalcTics();
+	SkewClock(-600);
+	ClockCheck("frame across a jump", tics <= 3);
+
+	exit(clockfailures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*
+================
+=
+= TransformBench
+=
+= -xformbench: projects a full load of objects scattered around a map from
+= every view angle with both TransformScalar and TransformBatch, checks
+= that they agree and prints how long each took.  Needs no game data
+=
+================
+*/
+
+#define BENCHPASSES	20
+
+static transform_t benchscalar, benchbatch;
+
+static long BenchPass(void (*transform)(transform_t *), transform_t *t)
+{
+	unsigned long start;
+	int pass, angle;
+
+	start = get_TimeStamp();
+	for (pass=0;pass<BENCHPASSES;pass++)
+		for (angle=0;angle<ANGLES;angle++)
+		{
+			viewsin = sintable[angle];
+			viewcos = costable[angle];
+			transform(t);
+		}
+
+	return get_TimeStamp() - start;
+}
+
+void TransformBench()
+{
+	long scalarus, batchus, points;
+	int i, angle, mismatches;
+
+	BuildTables();
+	vwidth = 320;
+	vheight = 200;
+	NewViewSize(19);
+
+	viewx = (32l<<TILESHIFT)+0x1234;
+	viewy = (32l<<TILESHIFT)+0x8765;
+
+	US_InitRndT(false);
+	benchscalar.count = MAXTRANSFORM;
+	for (i=0;i<MAXTRANSFORM;i++)
+	{
+		benchscalar.x[i] = (US_RndT()%64<<TILESHIFT) + (US_RndT()<<8);
+		benchscalar.y[i] = (US_RndT()%64<<TILESHIFT) + (US_RndT()<<8);
+		benchscalar.forward[i] = i < MAXSTATS ? 0x2000 : 0x4000;
+	}
+	benchbatch = benchscalar;
+
+	mismatches = 0;
+	for (angle=0;angle<ANGLES;angle++)
+	{
+		viewsin = sintable[angle];
+		viewcos = costable[angle];
+		TransformScalar(&benchscalar);
+		TransformBatch(&benchbatch);
+		for (i=0;i<MAXTRANSFORM;i++)
+			if (benchscalar.nx[i] != benchbatch.nx[i]
+			|| benchscalar.ny[i] != benchbatch.ny[i]
+			|| benchscalar.viewheight[i] != benchbatch.viewheight[i]
+			|| (benchscalar.viewheight[i] && benchscalar.viewx[i] != benchbatch.viewx[i]))
+				mismatches++;
+	}
+
+	scalarus = BenchPass(TransformScalar, &benchscalar);
+	batchus = BenchPass(TransformBatch, &benchbatch);
+	points = (long)BENCHPASSES*ANGLES*MAXTRANSFORM;
+
+	printf("xformbench: %ld points, %d mismatches\n", points, mismatches);
+	printf("xformbench: scalar %6ld us  %4ld ns/point\n", scalarus, scalarus*1000/points);
+	printf("xformbench: batch  %6ld us  %4ld ns/point\n", batchus, batchus*1000/points);
+
+	exit(mismatches ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 /*
 ================
 =
@@ -103,6 +363,12 @@ int DebugKeys()
 	boolean esc;
 	int level;
 
+	if (IN_KeyDown(sc_B))		// B = benchmark actors
+	{
+		ActorBenchmark();
+		return 1;
+	}
+
 	if (IN_KeyDown(sc_C))		// C = count objects
 	{
 		CountObjects();
@@ -174,6 +440,18 @@ int DebugKeys()
 		IN_Ack ();
 		return 1;
 	}
+	else if (IN_KeyDown(sc_O))			// O = profiling overlay
+	{
+		profiling^=1;
+		CenterWindow (18,3);
+		if (profiling)
+			US_PrintCentered ("Profiling ON");
+		else
+			US_PrintCentered ("Profiling OFF");
+		VW_UpdateScreen();
+		IN_Ack ();
+		return 1;
+	}
 	else if (IN_KeyDown(sc_P))			// P = pause with no screen disruptioon
 	{
 		PicturePause ();
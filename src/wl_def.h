@@ -686,6 +686,7 @@ extern	int			shootdelta;
 
 extern	boolean         startgame,loadedgame;
 extern	int		mouseadjustment;
+extern	boolean		timedemo,simonly;
 
 /* math tables */
 extern int pixelangle[MAXVIEWWIDTH];
@@ -722,20 +723,74 @@ extern	gametype	gamestate;
 extern	int		doornum;
 
 extern	char		demoname[13];
+extern	long		demoseekto;
 
 extern	long		spearx,speary;
 extern	unsigned	spearangle;
 extern	boolean		spearflag;
 
+#ifdef SPEAR
+#define NUMLEVELRATIOS	20
+#else
+#define NUMLEVELRATIOS	8
+#endif
+
+//
+// everything needed to put a level back exactly as it was.  Pointers are
+// kept as array indexes (-1 for NULL) so a snapshot doesn't care where the
+// arrays live
+//
+typedef struct
+{
+	gametype	gamestate;
+	LRstruct	levelratios[NUMLEVELRATIOS];
+	int			mapon;
+	int			rndindex;
+
+	word		planes[MAPPLANES][MAPSIZE*MAPSIZE];
+	byte		tilemap[MAPSIZE][MAPSIZE];
+	int			actorat[MAPSIZE][MAPSIZE];
+
+	objtype		objlist[MAXACTORS];
+	int			objnext[MAXACTORS],objprev[MAXACTORS];
+	int			player,lastobj,objfreelist,killerobj,lastattacker;
+
+	statobj_t	statobjlist[MAXSTATS];
+	int			laststatobj;
+
+	doorobj_t	doorobjlist[MAXDOORS];
+	int			lastdoorobj,doornum;
+	unsigned	doorposition[MAXDOORS];
+	byte		areaconnect[NUMAREAS][NUMAREAS];
+	boolean		areabyplayer[NUMAREAS];
+
+	unsigned	pwallstate,pwallpos,pwallx,pwally;
+	int			pwalldir;
+
+	long		thrustspeed;
+	unsigned	plux,pluy;
+	int			anglefrac,facecount,gotgatgun;
+} worldsnap_t;
+
 
 void 	ScanInfoPlane (void);
 void	SetupGameLevel (void);
+void	SaveWorld (worldsnap_t *snap);
+void	RestoreWorld (worldsnap_t *snap);
+boolean	RestartLevel (void);
+void	KeepSaveSnapshot (const char *fn);
+boolean	RestoreSaveSnapshot (const char *fn);
 void 	DrawPlayScreen (void);
 void 	GameLoop (void);
 void ClearMemory (void);
 void PlayDemo(int demonumber);
 int PlayDemoFromFile(const char *demoname);
 void RecordDemo();
+void DemoChunkFull (void);
+void DemoKeyframe (void);
+void SeekDemo (long tic);
+unsigned long WorldHash (void);
+void DemoFrameTime (long usec);
 void DrawHighScores();
 void DrawPlayBorder();
 void DrawPlayBorderSides();
@@ -769,7 +824,7 @@ extern	byte		tilemap[MAPSIZE][MAPSIZE];	// wall values only
 extern	byte		spotvis[MAPSIZE][MAPSIZE];
 extern	int		actorat[MAPSIZE][MAPSIZE];
 
-extern	boolean		singlestep,godmode,noclip;
+extern	boolean		singlestep,godmode,noclip,profiling;
 
 //
 // control info
@@ -799,13 +854,16 @@ extern	memptr		demobuffer;
 void StatusDrawPic(unsigned x, unsigned y, unsigned picnum);
 
 void	InitRedShifts (void);
+void 	ClearPaletteShifts (void);
 void 	FinishPaletteShifts (void);
 
 void	CenterWindow(word w,word h);
 void 	InitActorList (void);
 void 	GetNewActor (void);
+void	DoActor (objtype *ob);
 void 	StopMusic(void);
 void 	StartMusic(void);
+void	PlayTic (void);
 void	PlayLoop (void);
 void StartDamageFlash (int damage);
 void StartBonusFlash (void);
@@ -835,7 +893,10 @@ void PG13();
 */
 
 int DebugKeys (void);
+void ClockTest (void);
+void TransformBench (void);
 void PicturePause (void);
+void DrawProfileOverlay (void);
 
 /*
 =============================================================================
@@ -846,18 +907,35 @@ void PicturePause (void);
 */
 
 extern long lasttimecount;
+extern fixed ticfrac;
 extern long frameon;
 
 /* refresh variables */
 extern fixed viewx, viewy;			/* the focal point */
 extern fixed viewsin, viewcos;
 
+extern boolean norender;
+
+/* structure-of-arrays view of the objects DrawScaleds projects */
+#define MAXTRANSFORM	(MAXSTATS+MAXACTORS)
+
+typedef struct {
+	int	count;
+	int32_t	x[MAXTRANSFORM], y[MAXTRANSFORM];
+	int32_t	forward[MAXTRANSFORM];
+	int32_t	nx[MAXTRANSFORM], ny[MAXTRANSFORM];
+	int	viewx[MAXTRANSFORM], viewheight[MAXTRANSFORM];
+} transform_t;
+
 extern int horizwall[], vertwall[];
 
 
 void BuildTables();
 void CalcTics();
 void ThreeDRefresh();
+void SetupWallPages();
+void TransformBatch(transform_t *t);
+void TransformScalar(transform_t *t);
 
 void FizzleFade(boolean abortable, int frames, int color);
 
@@ -875,6 +953,7 @@ void FizzleFade(boolean abortable, int frames, int color);
 void	SpawnNewObj(unsigned tilex, unsigned tiley, int state); /* stateenum */ 
 void	NewState(objtype *ob, int state); /* stateenum */
 
+void	InitFlowField (void);
 boolean TryWalk (objtype *ob);
 void 	SelectChaseDir (objtype *ob);
 void 	SelectDodgeDir (objtype *ob);
@@ -885,7 +964,12 @@ boolean SightPlayer (objtype *ob);
 void	KillActor (objtype *ob);
 void	DamageActor (objtype *ob, unsigned damage);
 
+extern	long	sightchecks,sightculled,sightcached,sightprechecked;
+
+void	InitSightCache (void);
+void	InvalidateSightCache (void);
 boolean CheckLine (objtype *ob);
+void	PrecheckSight (void);
 boolean	CheckSight (objtype *ob);
 
 /*
@@ -904,6 +988,8 @@ extern	unsigned	plux,pluy;		// player coordinates scaled to unsigned
 
 extern	int			anglefrac;
 extern	int			facecount;
+extern	int			gotgatgun;
+extern	objtype		*LastAttacker;
 
 void	SpawnPlayer (int tilex, int tiley, int dir);
 void 	DrawFace (void);
@@ -1,5 +1,9 @@
 #include "wl_def.h" 
 
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
 /* C AsmRefresh() and related code
    originally from David Haslam -- dch@sirius.demon.co.uk */
 
@@ -13,6 +17,8 @@ static unsigned wallheight[MAXVIEWWIDTH];
 /* refresh variables */
 fixed viewx, viewy;		/* the focal point */
 
+boolean norender;		/* trace the view, but don't draw it */
+
 static int viewangle;
 
 static unsigned tilehit;
@@ -80,10 +86,11 @@ void CalcProjection(long focal)
 /*
 ========================
 =
-= TransformActor
+= TransformBatch
 =
 = Takes paramaters:
-=   gx,gy		: globalx/globaly of point
+=   t->x,t->y		: global position of each point
+=   t->forward		: how far to pull each one toward the viewer
 =
 = globals:
 =   viewx,viewy		: point of view
@@ -91,119 +98,127 @@ void CalcProjection(long focal)
 =   scale		: conversion from global value to screen value
 =
 = sets:
-=   screenx,transx,transy,screenheight: projected edge location and size
+=   t->nx,t->ny			: view space location
+=   t->viewx,t->viewheight	: projected center and size, height 0 if
+=				  too close to draw
+=
+= Rotates four points at a time when built with SSE4.1.  All the values
+= involved fit in 32 bits, so this matches FixedByFrac exactly
 =
 ========================
 */
 
-static void TransformActor(objtype *ob)
+#ifdef __SSE4_1__
+static __m128i FixedByFrac4(__m128i a, __m128i b)
 {
-	fixed gx,gy,gxt,gyt,nx,ny;
+	__m128i even, odd;
 
-//
-// translate point to view centered coordinates
-//
-	gx = ob->x-viewx;
-	gy = ob->y-viewy;
+	even = _mm_srli_epi64(_mm_mul_epi32(a, b), TILESHIFT);
+	odd = _mm_srli_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), b), TILESHIFT);
 
-//
-// calculate newx
-//
-	gxt = FixedByFrac(gx, viewcos);
-	gyt = FixedByFrac(gy, viewsin);
-	nx = gxt-gyt-ACTORSIZE;		// fudge the shape forward a bit, because
-					// the midpoint could put parts of the shape
-					// into an adjacent wall
+	return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xcc);
+}
+#endif
 
-//
-// calculate newy
-//
-	gxt = FixedByFrac(gx,viewsin);
-	gyt = FixedByFrac(gy,viewcos);
-	ny = gyt+gxt;
+void TransformBatch(transform_t *t)
+{
+	int	i;
+	int32_t	gx,gy;
 
-//
-// calculate perspective ratio
-//
-	ob->transx = nx;
-	ob->transy = ny;
+	i = 0;
 
-	if (nx < MINDIST) /* too close, don't overflow the divide */
+#ifdef __SSE4_1__
 	{
-		ob->viewheight = 0;
-		return;
+		__m128i vx,vy,vcos,vsin,x,y,nx,ny;
+
+		vx = _mm_set1_epi32(viewx);
+		vy = _mm_set1_epi32(viewy);
+		vcos = _mm_set1_epi32(viewcos);
+		vsin = _mm_set1_epi32(viewsin);
+
+		for (; i+4 <= t->count; i += 4)
+		{
+			x = _mm_sub_epi32(_mm_loadu_si128((__m128i *)&t->x[i]), vx);
+			y = _mm_sub_epi32(_mm_loadu_si128((__m128i *)&t->y[i]), vy);
+
+			nx = _mm_sub_epi32(FixedByFrac4(x, vcos), FixedByFrac4(y, vsin));
+			nx = _mm_sub_epi32(nx, _mm_loadu_si128((__m128i *)&t->forward[i]));
+			ny = _mm_add_epi32(FixedByFrac4(y, vcos), FixedByFrac4(x, vsin));
+
+			_mm_storeu_si128((__m128i *)&t->nx[i], nx);
+			_mm_storeu_si128((__m128i *)&t->ny[i], ny);
+		}
 	}
+#endif
 
-	ob->viewx = centerx + ny*scale/nx;	
+	for (; i < t->count; i++)
+	{
+		gx = t->x[i]-viewx;
+		gy = t->y[i]-viewy;
 
-	ob->viewheight = heightnumerator/(nx>>8);
+		t->nx[i] = (((int64_t)gx*viewcos)>>TILESHIFT) - (((int64_t)gy*viewsin)>>TILESHIFT)
+			- t->forward[i];
+		t->ny[i] = (((int64_t)gy*viewcos)>>TILESHIFT) + (((int64_t)gx*viewsin)>>TILESHIFT);
+	}
+
+//
+// calculate perspective ratio
+//
+	for (i = 0; i < t->count; i++)
+	{
+		if (t->nx[i] < MINDIST)		/* too close, don't overflow the divide */
+		{
+			t->viewheight[i] = 0;
+			continue;
+		}
+
+		t->viewx[i] = centerx + (fixed)t->ny[i]*scale/t->nx[i];
+		t->viewheight[i] = heightnumerator/(t->nx[i]>>8);
+	}
 }
 
 /*
 ========================
 =
-= TransformTile
-=
-= Takes paramaters:
-=   tx,ty		: tile the object is centered in
-=
-= globals:
-=   viewx,viewy		: point of view
-=   viewcos,viewsin	: sin/cos of viewangle
-=   scale		: conversion from global value to screen value
-=
-= sets:
-=   screenx,transx,transy,screenheight: projected edge location and size
+= TransformScalar
 =
-= Returns true if the tile is withing getting distance
+= The same as TransformBatch, one point and one FixedByFrac at a time the
+= way TransformActor and TransformTile used to.  Kept to check and time the
+= batched version against (-xformbench)
 =
 ========================
 */
 
-static boolean TransformTile(int tx, int ty, int *dispx, int *dispheight)
+void TransformScalar(transform_t *t)
 {
-	fixed gx,gy,gxt,gyt,nx,ny;
+	int	i;
+	fixed	gx,gy,gxt,gyt,nx,ny;
 
-//
-// translate point to view centered coordinates
-//
-	gx = ((long)tx<<TILESHIFT)+0x8000-viewx;
-	gy = ((long)ty<<TILESHIFT)+0x8000-viewy;
+	for (i = 0; i < t->count; i++)
+	{
+		gx = t->x[i]-viewx;
+		gy = t->y[i]-viewy;
 
-//
-// calculate newx
-//
-	gxt = FixedByFrac(gx,viewcos);
-	gyt = FixedByFrac(gy,viewsin);
-	nx = gxt-gyt-0x2000;		// 0x2000 is size of object
+		gxt = FixedByFrac(gx,viewcos);
+		gyt = FixedByFrac(gy,viewsin);
+		nx = gxt-gyt-t->forward[i];
 
-//
-// calculate newy
-//
-	gxt = FixedByFrac(gx,viewsin);
-	gyt = FixedByFrac(gy,viewcos);
-	ny = gyt+gxt;
-
-//
-// calculate perspective ratio
-//
-	if (nx<MINDIST)			/* too close, don't overflow the divide */
-	{
-		*dispheight = 0;
-		return false;
-	}
+		gxt = FixedByFrac(gx,viewsin);
+		gyt = FixedByFrac(gy,viewcos);
+		ny = gyt+gxt;
 
-	*dispx = centerx + ny*scale/nx;	
+		t->nx[i] = nx;
+		t->ny[i] = ny;
 
-	*dispheight = heightnumerator/(nx>>8);
+		if (nx < MINDIST)
+		{
+			t->viewheight[i] = 0;
+			continue;
+		}
 
-//
-// see if it should be grabbed
-//
-	if ( (nx<TILEGLOBAL) && (ny>-TILEGLOBAL/2) && (ny<TILEGLOBAL/2) )
-		return true;
-	else
-		return false;
+		t->viewx[i] = centerx + ny*scale/nx;
+		t->viewheight[i] = heightnumerator/(nx>>8);
+	}
 }
 
 /* ======================================================================== */
@@ -265,9 +280,13 @@ typedef struct {
 
 static visobj_t vislist[MAXVISABLE], *visptr, *visstep, *farthest;
 
+static transform_t xform;		/* statics first, then actors */
+static statobj_t *xformstat[MAXSTATS];
+static objtype *xformobj[MAXACTORS];
+
 static void DrawScaleds()
 {
-	int 		i,least,numvisable,height;
+	int 		i,least,numvisable,height,numstat;
 	byte		*tilespot,*visspot;
 	unsigned	spotloc;
 
@@ -276,35 +295,30 @@ static void DrawScaleds()
 
 	visptr = &vislist[0];
 
-/* place static objects */
+//
+// gather everything that could be seen, so it can be transformed in one go
+//
+	xform.count = 0;
+
 	for (statptr = &statobjlist[0]; statptr != laststatobj; statptr++)
 	{
-		if ((visptr->shapenum = statptr->shapenum) == -1)
+		if (statptr->shapenum == -1)
 			continue;			/* object has been deleted */
 
 		if (!*statptr->visspot)
 			continue;			/* not visable */
 
-		if (TransformTile(statptr->tilex, statptr->tiley
-			,&visptr->viewx,&visptr->viewheight) && statptr->flags & FL_BONUS)
-		{
-			GetBonus(statptr);
-			continue;
-		}
-
-		if (!visptr->viewheight)
-			continue;			/* too close to the object */
-
-		if (visptr < &vislist[MAXVISABLE-1])	/* don't let it overflow */
-			visptr++;
+		i = xform.count++;
+		xformstat[i] = statptr;
+		xform.x[i] = ((long)statptr->tilex<<TILESHIFT)+0x8000;
+		xform.y[i] = ((long)statptr->tiley<<TILESHIFT)+0x8000;
+		xform.forward[i] = 0x2000;	// 0x2000 is size of object
 	}
+	numstat = xform.count;
 
-//
-// place active objects
-//
 	for (obj = player->next; obj; obj = obj->next)
 	{
-		if (!(visptr->shapenum = gamestates[obj->state].shapenum))
+		if (!gamestates[obj->state].shapenum)
 			continue;  // no shape
 
 		spotloc = (obj->tilex << 6) + obj->tiley;
@@ -325,25 +339,80 @@ static void DrawScaleds()
 		|| (*(visspot+63) && !*(tilespot+63))) 
 		{
 			obj->active = ac_yes;
-			TransformActor(obj);
-			if (!obj->viewheight)
-				continue;						// too close or far away
-
-			visptr->viewx = obj->viewx;
-			visptr->viewheight = obj->viewheight;
-			if (visptr->shapenum == -1)
-				visptr->shapenum = obj->temp1;	// special shape
 
-			if (gamestates[obj->state].rotate)
-				visptr->shapenum += CalcRotate(obj);
-
-			if (visptr < &vislist[MAXVISABLE-1])	/* don't let it overflow */
-				visptr++;
-			obj->flags |= FL_VISABLE;
+			i = xform.count++;
+			xformobj[i-numstat] = obj;
+			xform.x[i] = obj->x;
+			xform.y[i] = obj->y;
+			xform.forward[i] = ACTORSIZE;	// fudge the shape forward a bit, because
+							// the midpoint could put parts of the shape
+							// into an adjacent wall
 		} else
 			obj->flags &= ~FL_VISABLE;
 	}
 
+	TransformBatch(&xform);
+
+//
+// place static objects
+//
+	for (i = 0; i < numstat; i++)
+	{
+		statptr = xformstat[i];
+
+		//
+		// see if it should be grabbed
+		//
+		if (xform.nx[i] >= MINDIST && xform.nx[i] < TILEGLOBAL
+		&& xform.ny[i] > -TILEGLOBAL/2 && xform.ny[i] < TILEGLOBAL/2
+		&& statptr->flags & FL_BONUS)
+		{
+			GetBonus(statptr);
+			continue;
+		}
+
+		if (!xform.viewheight[i])
+			continue;			/* too close to the object */
+
+		visptr->shapenum = statptr->shapenum;
+		visptr->viewx = xform.viewx[i];
+		visptr->viewheight = xform.viewheight[i];
+
+		if (visptr < &vislist[MAXVISABLE-1])	/* don't let it overflow */
+			visptr++;
+	}
+
+//
+// place active objects
+//
+	for (i = numstat; i < xform.count; i++)
+	{
+		obj = xformobj[i-numstat];
+
+		obj->transx = xform.nx[i];
+		obj->transy = xform.ny[i];
+		obj->viewheight = xform.viewheight[i];
+		if (!obj->viewheight)
+			continue;						// too close or far away
+		obj->viewx = xform.viewx[i];
+
+		visptr->viewx = obj->viewx;
+		visptr->viewheight = obj->viewheight;
+		visptr->shapenum = gamestates[obj->state].shapenum;
+		if (visptr->shapenum == -1)
+			visptr->shapenum = obj->temp1;	// special shape
+
+		if (gamestates[obj->state].rotate)
+			visptr->shapenum += CalcRotate(obj);
+
+		if (visptr < &vislist[MAXVISABLE-1])	/* don't let it overflow */
+			visptr++;
+		obj->flags |= FL_VISABLE;
+	}
+
+	if (norender)
+		return;
+
 //
 // draw from back to front
 //
@@ -647,6 +716,15 @@ void ThreeDRefresh()
 /* clear out the traced array */
 	memset(spotvis, 0, sizeof(spotvis));
 
+/* actors wake up, get aimed at and bonuses get picked up while the */
+/* view is traced, so that much has to happen even when not drawing */
+	if (norender) {
+		WallRefresh();
+		DrawScaleds();
+		frameon++;
+		return;
+	}
+
 #ifndef DRAWCEIL	
 	ClearScreen();
 #endif	
@@ -660,6 +738,9 @@ void ThreeDRefresh()
 	DrawScaleds();		/* draw scaled stuff */
 	DrawPlayerWeapon();	/* draw player's hands */
 
+	if (profiling)
+		DrawProfileOverlay();
+
 /* show screen and time last cycle */	
 	VW_UpdateScreen();
 	frameon++;
@@ -877,73 +958,100 @@ static void ScalePost(byte *wall, int texture)
 	int height;
 	byte *source;
 
+	if (norender)
+		return;
+		
 	height = (wallheight[postx] & 0xFFF8) >> 2;
 	
 	source = wall+texture;
 	ScaleLine(height, source, postx);
 }
 
+/*
+====================
+=
+= SetupWallPages
+=
+= Looks up every wall, door and door side page once at startup, so the
+= Hit* routines below can index straight to the texture instead of going
+= through PM_GetPage for each post.  The page manager never lets go of a
+= page once it's loaded, so the pointers stay good
+=
+====================
+*/
+
+static byte *horizwallpage[MAXWALLTILES], *vertwallpage[MAXWALLTILES];
+static byte *horizdoorpage[dr_elevator+1], *vertdoorpage[dr_elevator+1];
+static byte *horizdoorside, *vertdoorside;
+
+static byte *WallPage(int pagenum)
+{
+	/* the high tiles run on into the sprites, and a page file can leave */
+	/* out walls no map uses */
+	if (pagenum >= PMSpriteStart || PMPages[pagenum].offset == 0)
+		return NULL;
+
+	return PM_GetPage(pagenum);
+}
+
+void SetupWallPages()
+{
+	int i, doorpage;
+
+	for (i = 0; i < MAXWALLTILES; i++) {
+		horizwallpage[i] = WallPage(horizwall[i]);
+		vertwallpage[i] = WallPage(vertwall[i]);
+	}
+
+	for (i = dr_normal; i <= dr_elevator; i++) {
+		switch(i) {
+			case dr_lock1:
+			case dr_lock2:
+			case dr_lock3:
+			case dr_lock4:
+				doorpage = DOORWALL+6;
+				break;
+			case dr_elevator:
+				doorpage = DOORWALL+4;
+				break;
+			default:
+				doorpage = DOORWALL;
+				break;
+		}
+		horizdoorpage[i] = PM_GetPage(doorpage);
+		vertdoorpage[i] = PM_GetPage(doorpage+1);
+	}
+
+	horizdoorside = PM_GetPage(DOORWALL+2);
+	vertdoorside = PM_GetPage(DOORWALL+3);
+}
+
 static void HitHorizDoor()
 {
-	unsigned texture, doorpage = 0, doornum;
-	byte *wall;
+	unsigned texture, doornum;
 
 	doornum = tilehit&0x7f;
 	texture = ((xintercept-doorposition[doornum]) >> 4) & 0xfc0;
 
 	wallheight[postx] = CalcHeight();
 
-	switch(doorobjlist[doornum].lock) {
-		case dr_normal:
-			doorpage = DOORWALL;
-			break;
-		case dr_lock1:
-		case dr_lock2:
-		case dr_lock3:
-		case dr_lock4:
-			doorpage = DOORWALL+6;
-			break;
-		case dr_elevator:
-			doorpage = DOORWALL+4;
-			break;
-	}
-
-	wall = PM_GetPage(doorpage);
-	ScalePost(wall, texture);
+	ScalePost(horizdoorpage[doorobjlist[doornum].lock], texture);
 }
 
 static void HitVertDoor()
 {
-	unsigned texture, doorpage = 0, doornum;
-	byte *wall;
+	unsigned texture, doornum;
 
 	doornum = tilehit&0x7f;
 	texture = ((yintercept-doorposition[doornum]) >> 4) & 0xfc0;
 
 	wallheight[postx] = CalcHeight();
 
-	switch(doorobjlist[doornum].lock) {
-		case dr_normal:
-			doorpage = DOORWALL;
-			break;
-		case dr_lock1:
-		case dr_lock2:
-		case dr_lock3:
-		case dr_lock4:
-			doorpage = DOORWALL+6;
-			break;
-		case dr_elevator:
-			doorpage = DOORWALL+4;
-			break;
-	}
-
-	wall = PM_GetPage(doorpage+1);
-	ScalePost(wall, texture);
+	ScalePost(vertdoorpage[doorobjlist[doornum].lock], texture);
 }
 
 static void HitVertWall()
 {
-	int wallpic;
 	unsigned texture;
 	byte *wall;
 
@@ -959,19 +1067,17 @@ static void HitVertWall()
 	if (tilehit & 0x40) { // check for adjacent doors
 		ytile = yintercept>>TILESHIFT;
 		if (tilemap[xtile-xtilestep][ytile] & 0x80)
-			wallpic = DOORWALL+3;
+			wall = vertdoorside;
 		else
-			wallpic = vertwall[tilehit & ~0x40];
+			wall = vertwallpage[tilehit & ~0x40];
 	} else
-		wallpic = vertwall[tilehit];
+		wall = vertwallpage[tilehit];
 		
-	wall = PM_GetPage(wallpic);
 	ScalePost(wall, texture);
 }
 
 static void HitHorizWall()
 {
-	int wallpic;
 	unsigned texture;
 	byte *wall;
 
@@ -987,21 +1093,18 @@ static void HitHorizWall()
 	if (tilehit & 0x40) { // check for adjacent doors
 		xtile = xintercept>>TILESHIFT;
 		if (tilemap[xtile][ytile-ytilestep] & 0x80)
-			wallpic = DOORWALL+2;
+			wall = horizdoorside;
 		else
-			wallpic = horizwall[tilehit & ~0x40];
+			wall = horizwallpage[tilehit & ~0x40];
 	} else
-		wallpic = horizwall[tilehit];
+		wall = horizwallpage[tilehit];
 
-	wall = PM_GetPage(wallpic);
 	ScalePost(wall, texture);
 }
 
 static void HitHorizPWall()
 {
-	int wallpic;
 	unsigned texture, offset;
-	byte *wall;
 	
 	texture = (xintercept >> 4) & 0xfc0;
 	
@@ -1016,16 +1119,12 @@ static void HitHorizPWall()
 
 	wallheight[postx] = CalcHeight();
 
-	wallpic = horizwall[tilehit&63];
-	wall = PM_GetPage(wallpic);
-	ScalePost(wall, texture);
+	ScalePost(horizwallpage[tilehit&63], texture);
 }
 
 static void HitVertPWall()
 {
-	int wallpic;
 	unsigned texture, offset;
-	byte *wall;
 	
 	texture = (yintercept >> 4) & 0xfc0;
 	offset = pwallpos << 10;
@@ -1038,10 +1137,7 @@ static void HitVertPWall()
 
 	wallheight[postx] = CalcHeight();
 	
-	wallpic = vertwall[tilehit&63];
-
-	wall = PM_GetPage(wallpic);
-	ScalePost(wall, texture);
+	ScalePost(vertwallpage[tilehit&63], texture);
 }
 
 #define DEG90	900
@@ -1339,7 +1435,7 @@ void FizzleFade(boolean abortable, int frames, int color)
 		VW_UpdateScreen();
 				
 		frame++;
-		while (get_TimeCount() < frame);
+		WaitTimeCount(frame);
 	} while (retr == -1);
 
 	VW_UpdateScreen();	
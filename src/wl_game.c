@@ -1,5 +1,11 @@
 #include "wl_def.h"
 
+#include <sys/stat.h>
+
+#ifdef _REENTRANT
+#include <pthread.h>
+#endif
+
 /*
 =============================================================================
 
@@ -15,6 +21,13 @@ long		spearx,speary;
 unsigned	spearangle;
 boolean		spearflag;
 
+static worldsnap_t levelstart, savesnap;	// see WORLD SNAPSHOTS
+static boolean levelstartvalid;
+static char savesnapname[13];
+static struct stat savesnapstat;	// the file savesnap was written to
+
+static int demoseed;	// random table index for the demo being played or recorded
+
 /* ELEVATOR BACK MAPS - REMEMBER (-1)!! */
 #ifndef SPEAR
 static const int ElevatorBackTo[]={ 1, 1, 7, 3, 5, 3};
@@ -465,7 +478,7 @@ void SetupGameLevel()
 	}
 
 	if (demoplayback || demorecord)
-		US_InitRndT(false);
+		US_SetRndT(demoseed);
 	else
 		US_InitRndT(true);
 
@@ -557,7 +570,247 @@ void SetupGameLevel()
 			}
 		}
 
+	InitSightCache();
+	InitFlowField();
+
 	CA_LoadAllSounds();
+
+	//
+	// keep the fresh level around, so dying doesn't have to build it again
+	//
+	levelstartvalid = !loadedgame;
+	if (levelstartvalid)
+		SaveWorld (&levelstart);
+}
+
+/* ======================================================================== */
+
+/*
+=============================================================================
+
+						WORLD SNAPSHOTS
+
+A snapshot holds every array the level lives in, so putting a level back is
+a handful of block copies.  The links between actors and the few global
+pointers are turned into indexes on the way in and back on the way out.
+
+=============================================================================
+*/
+
+#define OBJINDEX(p)	((p) ? (int)((p)-objlist) : -1)
+#define OBJPTR(i)	((i) == -1 ? NULL : &objlist[i])
+
+/*
+==================
+=
+= SaveWorld
+=
+==================
+*/
+
+void SaveWorld(worldsnap_t *snap)
+{
+	int i;
+
+	snap->gamestate = gamestate;
+	memcpy(snap->levelratios, LevelRatios, sizeof(snap->levelratios));
+	snap->mapon = mapon;
+	snap->rndindex = US_GetRndT();
+
+	for (i = 0; i < MAPPLANES; i++)
+		memcpy(snap->planes[i], mapsegs[i], sizeof(snap->planes[i]));
+	memcpy(snap->tilemap, tilemap, sizeof(tilemap));
+	memcpy(snap->actorat, actorat, sizeof(actorat));
+
+	memcpy(snap->objlist, objlist, sizeof(objlist));
+	for (i = 0; i < MAXACTORS; i++) {
+		snap->objnext[i] = OBJINDEX(objlist[i].next);
+		snap->objprev[i] = OBJINDEX(objlist[i].prev);
+	}
+	snap->player = OBJINDEX(player);
+	snap->lastobj = OBJINDEX(lastobj);
+	snap->objfreelist = OBJINDEX(objfreelist);
+	snap->killerobj = OBJINDEX(killerobj);
+	snap->lastattacker = OBJINDEX(LastAttacker);
+
+	memcpy(snap->statobjlist, statobjlist, sizeof(statobjlist));
+	snap->laststatobj = laststatobj - statobjlist;
+
+	memcpy(snap->doorobjlist, doorobjlist, sizeof(doorobjlist));
+	snap->lastdoorobj = lastdoorobj - doorobjlist;
+	snap->doornum = doornum;
+	memcpy(snap->doorposition, doorposition, sizeof(doorposition));
+	memcpy(snap->areaconnect, areaconnect, sizeof(areaconnect));
+	memcpy(snap->areabyplayer, areabyplayer, sizeof(areabyplayer));
+
+	snap->pwallstate = pwallstate;
+	snap->pwallpos = pwallpos;
+	snap->pwallx = pwallx;
+	snap->pwally = pwally;
+	snap->pwalldir = pwalldir;
+
+	snap->thrustspeed = thrustspeed;
+	snap->plux = plux;
+	snap->pluy = pluy;
+	snap->anglefrac = anglefrac;
+	snap->facecount = facecount;
+	snap->gotgatgun = gotgatgun;
+}
+
+/*
+==================
+=
+= RestoreWorld
+=
+= The map in the snapshot must be the one that is loaded
+=
+==================
+*/
+
+void RestoreWorld(worldsnap_t *snap)
+{
+	int i;
+
+	gamestate = snap->gamestate;
+	memcpy(LevelRatios, snap->levelratios, sizeof(snap->levelratios));
+	mapon = snap->mapon;
+	US_SetRndT(snap->rndindex);
+
+	for (i = 0; i < MAPPLANES; i++)
+		memcpy(mapsegs[i], snap->planes[i], sizeof(snap->planes[i]));
+	memcpy(tilemap, snap->tilemap, sizeof(tilemap));
+	memcpy(actorat, snap->actorat, sizeof(actorat));
+
+	memcpy(objlist, snap->objlist, sizeof(objlist));
+	for (i = 0; i < MAXACTORS; i++) {
+		objlist[i].next = OBJPTR(snap->objnext[i]);
+		objlist[i].prev = OBJPTR(snap->objprev[i]);
+	}
+	player = OBJPTR(snap->player);
+	lastobj = OBJPTR(snap->lastobj);
+	objfreelist = OBJPTR(snap->objfreelist);
+	killerobj = OBJPTR(snap->killerobj);
+	LastAttacker = OBJPTR(snap->lastattacker);
+
+	memcpy(statobjlist, snap->statobjlist, sizeof(statobjlist));
+	laststatobj = statobjlist + snap->laststatobj;
+	for (i = 0; i < MAXSTATS; i++)
+		statobjlist[i].visspot = &spotvis[statobjlist[i].tilex][statobjlist[i].tiley];
+
+	memcpy(doorobjlist, snap->doorobjlist, sizeof(doorobjlist));
+	lastdoorobj = doorobjlist + snap->lastdoorobj;
+	doornum = snap->doornum;
+	memcpy(doorposition, snap->doorposition, sizeof(doorposition));
+	memcpy(areaconnect, snap->areaconnect, sizeof(areaconnect));
+	memcpy(areabyplayer, snap->areabyplayer, sizeof(areabyplayer));
+
+	pwallstate = snap->pwallstate;
+	pwallpos = snap->pwallpos;
+	pwallx = snap->pwallx;
+	pwally = snap->pwally;
+	pwalldir = snap->pwalldir;
+
+	thrustspeed = snap->thrustspeed;
+	plux = snap->plux;
+	pluy = snap->pluy;
+	anglefrac = snap->anglefrac;
+	facecount = snap->facecount;
+	gotgatgun = snap->gotgatgun;
+
+	InvalidateSightCache();
+	InitFlowField();
+}
+
+/*
+==================
+=
+= RestartLevel
+=
+= Puts the current level back the way SetupGameLevel left it, keeping the
+= player's lives, score and weapons.  Returns false if there is no fresh
+= copy of this level, and SetupGameLevel has to be called
+=
+==================
+*/
+
+boolean RestartLevel()
+{
+	gametype keep;
+
+	if (!levelstartvalid || levelstart.gamestate.mapon != gamestate.mapon
+	|| levelstart.gamestate.episode != gamestate.episode)
+		return false;
+
+	keep = gamestate;
+	RestoreWorld(&levelstart);
+
+	//
+	// only the level counters come from the snapshot
+	//
+	keep.TimeCount = gamestate.TimeCount;
+	keep.secrettotal = gamestate.secrettotal;
+	keep.killtotal = gamestate.killtotal;
+	keep.treasuretotal = gamestate.treasuretotal;
+	keep.secretcount = gamestate.secretcount;
+	keep.killcount = gamestate.killcount;
+	keep.treasurecount = gamestate.treasurecount;
+	gamestate = keep;
+
+	if (!demoplayback && !demorecord)
+		US_InitRndT(true);
+
+	return true;
+}
+
+/*
+==================
+=
+= KeepSaveSnapshot
+=
+= Call after a game has been saved to fn.  Loading fn again while still on
+= the same level is then done from memory, as long as the file hasn't
+= been replaced since
+=
+==================
+*/
+
+void KeepSaveSnapshot(const char *fn)
+{
+	if (stat(fn, &savesnapstat) == -1) {
+		*savesnapname = 0;
+		return;
+	}
+
+	SaveWorld(&savesnap);
+	strncpy(savesnapname, fn, sizeof(savesnapname)-1);
+}
+
+/*
+==================
+=
+= RestoreSaveSnapshot
+=
+= Returns false if fn has to be read from disk
+=
+==================
+*/
+
+boolean RestoreSaveSnapshot(const char *fn)
+{
+	struct stat st;
+
+	if (!ingame || !*savesnapname || strcmp(savesnapname, fn)
+	|| savesnap.gamestate.mapon != gamestate.mapon
+	|| savesnap.gamestate.episode != gamestate.episode)
+		return false;
+
+/* another copy of the game, or the player, may have put a new save there */
+	if (stat(fn, &st) == -1 || st.st_size != savesnapstat.st_size
+	|| st.st_mtime != savesnapstat.st_mtime || st.st_ino != savesnapstat.st_ino)
+		return false;
+
+	RestoreWorld(&savesnap);
+	return true;
 }
 
 /* ======================================================================== */
@@ -655,25 +908,149 @@ void DrawPlayScreen()
 
 /* ======================================================================= */
 
+/*
+=============================================================================
+
+						DEMO RECORDING
+
+Frames are appended to a small ring of chunks, and full chunks are written
+to a temporary file by a writer thread, so there is no limit on the length
+of a recording.  The file gets its real name once it has been numbered.
+
+Demo header: "WDM2", frame bytes (long), episode, map, difficulty and
+random table index (words).  Old demos start with the level byte and a
+word length that counts the four header bytes.
+
+=============================================================================
+*/
+
+#define DEMOMAGIC	"WDM2"
+#define DEMOHEADER	16
+#define DEMOCHUNK	(3*1365)		// whole frames only
+#define DEMOCHUNKS	4
+
+static	byte		demochunks[DEMOCHUNKS][DEMOCHUNK];
+static	int			demohead,demotail;	// [demotail,demohead) wait for the disk
+static	int			demofile = -1;
+static	long		demolength;
+static	boolean		demowriteerror;
+static	char		demotemp[] = "demo.tmp";
+
+#ifdef _REENTRANT
+static	pthread_t		demothread;
+static	pthread_mutex_t	demolock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t	demowake = PTHREAD_COND_INITIALIZER;
+static	boolean			demostop;
+#endif
+
+
+static void WriteDemoChunk (int chunk, int length)
+{
+	if (WriteBytes (demofile,demochunks[chunk%DEMOCHUNKS],length) != length)
+		demowriteerror = true;
+}
+
+
+#ifdef _REENTRANT
+static void *DemoWriter (void *arg)
+{
+	pthread_mutex_lock (&demolock);
+	for (;;)
+	{
+		while (demotail == demohead && !demostop)
+			pthread_cond_wait (&demowake,&demolock);
+		if (demotail == demohead)
+			break;
+
+		pthread_mutex_unlock (&demolock);
+		WriteDemoChunk (demotail,DEMOCHUNK);
+		pthread_mutex_lock (&demolock);
+
+		demotail++;
+		pthread_cond_broadcast (&demowake);
+	}
+	pthread_mutex_unlock (&demolock);
+
+	return NULL;
+}
+#endif
+
+
 /*
 ==================
 =
-= StartDemoRecord
+= DemoChunkFull
+=
+= Called by PollControls when demoptr reaches lastdemoptr.  Hands the chunk
+= to the writer and moves on to the next one, only waiting if the whole
+= ring is still queued for the disk
 =
 ==================
 */
 
-#define MAXDEMOSIZE	8192
+void DemoChunkFull (void)
+{
+	demolength += DEMOCHUNK;
+
+#ifdef _REENTRANT
+	pthread_mutex_lock (&demolock);
+	demohead++;
+	pthread_cond_broadcast (&demowake);
+	while (demohead - demotail == DEMOCHUNKS)
+		pthread_cond_wait (&demowake,&demolock);
+	pthread_mutex_unlock (&demolock);
+#else
+	WriteDemoChunk (demohead,DEMOCHUNK);
+	demotail = ++demohead;
+#endif
 
-void StartDemoRecord(int levelnumber)
+	demoptr = demochunks[demohead%DEMOCHUNKS];
+	lastdemoptr = demoptr+DEMOCHUNK;
+}
+
+
+/*
+==================
+=
+= StartDemoRecord
+=
+==================
+*/
+
+void StartDemoRecord (void)
 {
-	MM_GetPtr(&demobuffer, MAXDEMOSIZE);
-	MM_SetLock(&demobuffer,true);
-	demoptr = (byte *)demobuffer;
-	lastdemoptr = demoptr+MAXDEMOSIZE;
+	byte	header[DEMOHEADER];
+
+	demofile = OpenWrite (demotemp);
+	if (demofile == -1)
+		Quit ("StartDemoRecord: Can't create demo.tmp!");
+
+	US_InitRndT (true);
+	demoseed = US_GetRndT ();
+
+	memcpy (header,DEMOMAGIC,4);
+	memset (header+4,0,4);		// length is filled in when finished
+	header[8] = gamestate.episode & 0xFF;
+	header[9] = gamestate.episode >> 8;
+	header[10] = gamestate.mapon & 0xFF;
+	header[11] = gamestate.mapon >> 8;
+	header[12] = gamestate.difficulty & 0xFF;
+	header[13] = gamestate.difficulty >> 8;
+	header[14] = demoseed & 0xFF;
+	header[15] = demoseed >> 8;
+	demowriteerror = WriteBytes (demofile,header,DEMOHEADER) != DEMOHEADER;
+
+	demohead = demotail = 0;
+	demolength = 0;
+	demoptr = demochunks[0];
+	lastdemoptr = demoptr+DEMOCHUNK;
+
+#ifdef _REENTRANT
+	demostop = false;
+	if (pthread_create (&demothread,NULL,DemoWriter,NULL))
+		Quit ("StartDemoRecord: pthread_create failed!");
+#endif
 
-	*demoptr = levelnumber;
-	demoptr += 4;				// leave space for length
 	demorecord = true;
 }
 
@@ -689,16 +1066,35 @@ char demoname[13] = "demo?.dem";
 
 void FinishDemoRecord()
 {
-	long length, level;
+	long	level;
+	int		length;
+	byte	lengthbytes[4];
 
 	demorecord = false;
 
-	length = (byte *)demoptr - (byte *)demobuffer;
+	length = demoptr - demochunks[demohead%DEMOCHUNKS];
 
-	demoptr = ((byte *)demobuffer)+1;
+#ifdef _REENTRANT
+	pthread_mutex_lock (&demolock);
+	demostop = true;
+	pthread_cond_broadcast (&demowake);
+	pthread_mutex_unlock (&demolock);
+	pthread_join (demothread,NULL);
+#endif
 
-	demoptr[0] = length & 0xFF;
-	demoptr[1] = (length >> 8) & 0xFF;
+	WriteDemoChunk (demohead,length);
+	demolength += length;
+
+	lengthbytes[0] = demolength & 0xFF;
+	lengthbytes[1] = (demolength >> 8) & 0xFF;
+	lengthbytes[2] = (demolength >> 16) & 0xFF;
+	lengthbytes[3] = (demolength >> 24) & 0xFF;
+	WriteSeek (demofile,4,SEEK_SET);
+	if (WriteBytes (demofile,lengthbytes,4) != 4)
+		demowriteerror = true;
+
+	CloseWrite (demofile);
+	demofile = -1;
 
 	CenterWindow(24,3);
 	PrintY+=6;
@@ -709,14 +1105,15 @@ void FinishDemoRecord()
 	if (US_LineInput(px,py,str,NULL,true,2,0))
 	{
 		level = atoi (str);
-		if (level>=0 && level<=9)
+		if (level>=0 && level<=9 && !demowriteerror)
 		{
 			demoname[4] = '0'+level;
-			CA_WriteFile (demoname,(void *)demobuffer,length);
+			if (!rename (demotemp,demoname))
+				return;
 		}
 	}
 
-	MM_FreePtr(&demobuffer);
+	remove (demotemp);
 }
 
 /*
@@ -759,7 +1156,7 @@ void RecordDemo()
 	gamestate.mapon = level;
 #endif
 
-	StartDemoRecord(level);
+	StartDemoRecord();
 
 	DrawPlayScreen();
 	VW_UpdateScreen();
@@ -783,6 +1180,303 @@ void RecordDemo()
 	FinishDemoRecord ();
 }
 
+/*
+=============================================================================
+
+						DEMO KEYFRAMES
+
+While a demo plays, a world snapshot is kept every ten seconds.  Seeking
+puts back the nearest one at or before the target and runs the demo on
+from there with norender set, which takes a few milliseconds per second
+of demo.
+
+=============================================================================
+*/
+
+#define KEYFRAMEGAP		(10*TickBase/DEMOTICS)	// frames between keyframes
+#define MAXKEYFRAMES	256
+
+typedef struct
+{
+	long		frame;
+	long		funnyticount;
+	boolean		buttonstate[NUMBUTTONS];
+	worldsnap_t	world;
+} keyframe_t;
+
+long			demoseekto;		// -demoseek: tic to jump to when a demo starts
+
+static	byte		*demostart;
+static	keyframe_t	*keyframes[MAXKEYFRAMES];
+static	int			numkeyframes;
+
+
+static long DemoFrame (void)
+{
+	return (demoptr-demostart)/3;
+}
+
+
+static void FreeKeyframes (void)
+{
+	while (numkeyframes)
+		MM_FreePtr ((memptr *)&keyframes[--numkeyframes]);
+}
+
+
+/*
+==================
+=
+= DemoKeyframe
+=
+= Called before each demo frame is played
+=
+==================
+*/
+
+void DemoKeyframe (void)
+{
+	keyframe_t	*key;
+	long		frame;
+
+	frame = DemoFrame ();
+	if (frame % KEYFRAMEGAP || numkeyframes == MAXKEYFRAMES)
+		return;
+	if (numkeyframes && keyframes[numkeyframes-1]->frame >= frame)
+		return;				// already have this one
+
+	MM_GetPtr ((memptr *)&key,sizeof(*key));
+	if (!key)
+		return;
+
+	key->frame = frame;
+	key->funnyticount = funnyticount;
+	memcpy (key->buttonstate,buttonstate,sizeof(buttonstate));
+	SaveWorld (&key->world);
+
+	keyframes[numkeyframes++] = key;
+}
+
+
+/*
+==================
+=
+= SeekDemo
+=
+= Moves demo playback to the frame holding the given tic of the level
+=
+==================
+*/
+
+void SeekDemo (long tic)
+{
+	keyframe_t	*key;
+	long		frame,lastframe,start;
+	boolean		oldnorender;
+	int			i;
+
+	start = numkeyframes ? keyframes[0]->world.gamestate.TimeCount : gamestate.TimeCount;
+	frame = (tic-start)/DEMOTICS;
+	lastframe = (lastdemoptr-demostart)/3 - 1;	// playing the last frame ends the demo
+	if (frame > lastframe)
+		frame = lastframe;
+	if (frame < 0)
+		frame = 0;
+
+	for (i = numkeyframes-1; i >= 0 && keyframes[i]->frame > frame; i--)
+		;
+
+	if (i >= 0 && (frame < DemoFrame() || keyframes[i]->frame > DemoFrame()))
+	{
+		key = keyframes[i];
+		RestoreWorld (&key->world);
+		funnyticount = key->funnyticount;
+		memcpy (buttonstate,key->buttonstate,sizeof(buttonstate));
+		demoptr = demostart + key->frame*3;
+	}
+
+	oldnorender = norender;
+	norender = true;
+
+	while (DemoFrame() < frame && !playstate)
+	{
+		DemoKeyframe ();
+		tics = DEMOTICS;
+		PlayTic ();
+	}
+
+	norender = oldnorender;
+
+	ClearPaletteShifts ();
+	FinishPaletteShifts ();
+	DrawStatusBar ();
+	lasttimecount = get_TimeCount();
+}
+
+/*
+==================
+=
+= WorldHash
+=
+= FNV-1a over the state a demo replay should reproduce exactly: the
+= player, the score and level counters, the walls and every actor
+=
+==================
+*/
+
+static unsigned long HashLong (unsigned long hash, long value)
+{
+	int	i;
+
+	for (i = 0; i < 4; i++, value >>= 8)
+		hash = ((hash ^ (value & 0xFF)) * 16777619) & 0xFFFFFFFF;
+
+	return hash;
+}
+
+unsigned long WorldHash (void)
+{
+	unsigned long	hash;
+	objtype			*ob;
+	byte			*tile;
+
+	hash = 2166136261ul;
+
+	hash = HashLong (hash,player->x);
+	hash = HashLong (hash,player->y);
+	hash = HashLong (hash,player->angle);
+	hash = HashLong (hash,gamestate.health);
+	hash = HashLong (hash,gamestate.ammo);
+	hash = HashLong (hash,gamestate.score);
+	hash = HashLong (hash,gamestate.killcount);
+	hash = HashLong (hash,gamestate.secretcount);
+	hash = HashLong (hash,gamestate.treasurecount);
+	hash = HashLong (hash,gamestate.TimeCount);
+
+	for (tile = &tilemap[0][0]; tile < &tilemap[0][0] + MAPSIZE*MAPSIZE; tile++)
+		hash = ((hash ^ *tile) * 16777619) & 0xFFFFFFFF;
+
+	for (ob = player->next; ob; ob = ob->next)
+	{
+		hash = HashLong (hash,ob->x);
+		hash = HashLong (hash,ob->y);
+		hash = HashLong (hash,ob->state);
+		hash = HashLong (hash,ob->hitpoints);
+	}
+
+	return hash;
+}
+
+
+/*
+==================
+=
+= DemoFrameTime / PrintDemoStats
+=
+= -timedemo keeps the time spent on each frame, and prints one line per demo
+= for the demo farm to pick up:
+=
+= demo <file> hash <hash> tics <n> frames <n> usec <n> hist <FRAMEHIST counts>
+=
+= Histogram bucket i counts frames under 64<<i microseconds, the last one
+= everything slower
+=
+==================
+*/
+
+#define FRAMEHIST	10
+
+static	long	demoframes,demousec,demohist[FRAMEHIST];
+
+void DemoFrameTime (long usec)
+{
+	int	i;
+
+	for (i = 0; i < FRAMEHIST-1 && usec >= (64l << i); i++)
+		;
+
+	demohist[i]++;
+	demoframes++;
+	demousec += usec;
+}
+
+static void PrintDemoStats (const char *name)
+{
+	int	i;
+
+	printf ("demo %s hash %08lx tics %ld frames %ld usec %ld hist",
+		name,WorldHash(),gamestate.TimeCount,demoframes,demousec);
+	for (i = 0; i < FRAMEHIST; i++)
+		printf (" %ld",demohist[i]);
+	printf ("\n");
+	fflush (stdout);
+
+	demoframes = demousec = 0;
+	memset (demohist,0,sizeof(demohist));
+}
+
+
+/*
+==================
+=
+= StartDemoPlayback
+=
+= Sets up the game from either kind of demo header and points demoptr at
+= the first frame.  size is how much was loaded, or -1 for the game's own
+= demos, which are trusted to be as long as their headers say.  Anything
+= that doesn't fit, or names a level or difficulty that doesn't exist, is
+= refused.
+=
+==================
+*/
+
+static boolean StartDemoPlayback (byte *demo, long size)
+{
+	long	length;
+
+	NewGame (1,0);
+
+	if (size >= 0 && size < 4)
+		return false;
+
+	if (!memcmp (demo,DEMOMAGIC,4))
+	{
+		if (size >= 0 && size < DEMOHEADER)
+			return false;
+
+		length = demo[4] | (demo[5] << 8) | ((long)demo[6] << 16) | ((long)demo[7] << 24);
+		gamestate.episode = demo[8] | (demo[9] << 8);
+		gamestate.mapon = demo[10] | (demo[11] << 8);
+		gamestate.difficulty = demo[12] | (demo[13] << 8);
+		demoseed = demo[14] | (demo[15] << 8);
+		demoptr = demo+DEMOHEADER;
+	}
+	else
+	{
+		gamestate.mapon = demo[0];
+		gamestate.difficulty = gd_hard;
+		length = (demo[1] | (demo[2] << 8)) - 4;
+		demoseed = 0;
+		demoptr = demo+4;
+	}
+
+	demostart = demoptr;
+	FreeKeyframes ();
+
+	if (length <= 0 || length%3)
+		return false;
+	if (size >= 0 && length > size - (demoptr-demo))
+		return false;
+	if (gamestate.episode >= NUMMAPS/10
+	|| gamestate.mapon >= NUMMAPS - 10*gamestate.episode
+	|| gamestate.difficulty > gd_hard)
+		return false;
+
+	lastdemoptr = demoptr+length;
+
+	return true;
+}
+
 /*
 ==================
 =
@@ -795,8 +1489,6 @@ void RecordDemo()
 
 void PlayDemo(int demonumber)
 {
-	int length;
-
 #ifndef SPEARDEMO
 	int dems[4]={T_DEMO0,T_DEMO1,T_DEMO2,T_DEMO3};
 #else
@@ -804,16 +1496,10 @@ void PlayDemo(int demonumber)
 #endif
 
 	CA_CacheGrChunk(dems[demonumber]);
-	demoptr = grsegs[dems[demonumber]];
-
-	NewGame(1, 0);
-
-	gamestate.mapon = demoptr[0];
-	gamestate.difficulty = gd_hard;
-	length = demoptr[1] | (demoptr[2] << 8);
-	demoptr += 4;
-	
-	lastdemoptr = demoptr+length-4;
+	if (!StartDemoPlayback(grsegs[dems[demonumber]],-1)) {
+		CA_UnCacheGrChunk(dems[demonumber]);
+		return;
+	}
 
 	VW_FadeOut();
 
@@ -832,6 +1518,7 @@ void PlayDemo(int demonumber)
 
 	PlayLoop();
 
+	FreeKeyframes();
 	CA_UnCacheGrChunk(dems[demonumber]);
 
 	demoplayback = false;
@@ -843,43 +1530,56 @@ void PlayDemo(int demonumber)
 
 int PlayDemoFromFile(const char *demoname)
 {
-	int length;
+	int fd, size;
 
-	CA_LoadFile(demoname, &demobuffer);
-	if (demobuffer == NULL) {
+	fd = OpenRead(demoname);
+	if (fd == -1) {
+		fprintf(stderr, "Unable to load demo: %s\n", demoname);
+		return 0;
+	}
+	size = ReadWholeFile(fd, (byte **)&demobuffer);
+	CloseRead(fd);
+	if (size < 0) {
 		fprintf(stderr, "Unable to load demo: %s\n", demoname);
 		return 0;
 	}
-		
-	MM_SetLock(&demobuffer, true);
-	demoptr = (byte *)demobuffer;
 
-	NewGame(1,0);
-	gamestate.mapon = demoptr[0];
-	gamestate.difficulty = gd_hard;
-	length = demoptr[1] | (demoptr[2] << 8);
-	demoptr += 4;
-	lastdemoptr = demoptr-4+length;
+	if (!StartDemoPlayback((byte *)demobuffer, size)) {
+		fprintf(stderr, "Bad demo: %s\n", demoname);
+		free(demobuffer);
+		demobuffer = NULL;
+		return 0;
+	}
 
-	VW_FadeOut();
+	if (!timedemo) {
+		VW_FadeOut();
 
-	SETFONTCOLOR(0,15);
-	DrawPlayScreen();
-	VW_UpdateScreen(); /* force redraw */
+		SETFONTCOLOR(0,15);
+		DrawPlayScreen();
+		VW_UpdateScreen(); /* force redraw */
 	
-	VW_FadeIn();
+		VW_FadeIn();
+	}
 
 	startgame = false;
 	demoplayback = true;
+	norender = simonly;
 
 	SetupGameLevel();
-	StartMusic();
+	if (!timedemo || soundrender)
+		StartMusic();
 
 	PlayLoop();
 
-	MM_FreePtr(&demobuffer);
+	if (timedemo)
+		PrintDemoStats(demoname);
+
+	FreeKeyframes();
+	free(demobuffer);
+	demobuffer = NULL;
 
 	demoplayback = false;
+	norender = false;
 
 	StopMusic();
 	ClearMemory();	
@@ -1040,7 +1740,7 @@ restartgame:
 		startgame = false;
 		if (loadedgame)
 			loadedgame = false;
-		else
+		else if (!died || !RestartLevel())
 			SetupGameLevel();
 
 #ifdef SPEAR
@@ -1075,7 +1775,7 @@ startplayloop:
 			if (DigiMode == sds_Off) {
 				long lasttimecount = get_TimeCount();
 
-				while(get_TimeCount() < (lasttimecount+150)) ;
+				WaitTimeCount(lasttimecount+150);
 			} else
 				SD_WaitSoundDone();
 
@@ -62,7 +62,8 @@ void EndSpear()
 	
 	IN_StartAck ();
 	set_TimeCount(0);
-	while ( !IN_CheckAck () && (get_TimeCount() < 700) );
+	while ( !IN_CheckAck () && (get_TimeCount() < 700) )
+		IdleWait();
 
 	PrintX = 0;
 	PrintY = 180;
@@ -73,7 +74,8 @@ void EndSpear()
 	
 	IN_StartAck ();
 	set_TimeCount(0);
-	while ( !IN_CheckAck () && (get_TimeCount() < 700) );
+	while ( !IN_CheckAck () && (get_TimeCount() < 700) )
+		IdleWait();
 
 	VW_FadeOut ();
 
@@ -807,7 +809,10 @@ void LevelCompleted()
 	set_TimeCount(0);
 	IN_StartAck();
 	while(!IN_CheckAck())
+	{
 	  BJ_Breathe();
+	  IdleWait();
+	}
 
 //
 // done
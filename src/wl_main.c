@@ -28,8 +28,13 @@ int shootdelta;			/* pixels away from centerx a target can be */
 boolean startgame,loadedgame;
 int mouseadjustment;
 
+boolean timedemo;		/* -timedemo: run -playdemo files flat out and report */
+boolean simonly;		/* -simonly: the same, without drawing */
+int frametics = 2;		/* -framecap: fewest tics a frame may take */
+
 long frameon;
 long lasttimecount;
+fixed ticfrac;			/* fraction of a tic past lasttimecount, to interpolate by */
 fixed viewsin, viewcos;
 fixed viewx, viewy;		/* the focal point */
 int pixelangle[MAXVIEWWIDTH];
@@ -74,18 +79,27 @@ void CalcTics()
 {
 	int newtime;
 	int ticcount;
+	unsigned frac;
+	
+	if (timedemo && demoplayback) {
+		tics = DEMOTICS;
+		ticfrac = 0;
+		return;
+	}
 	
 	if (demoplayback || demorecord)
-		ticcount = DEMOTICS - 1; /* [70/4] 17.5 Hz */
+		ticcount = DEMOTICS; /* [70/4] 17.5 Hz */
 	else
-		ticcount = 0 + 1; /* 35 Hz */
+		ticcount = frametics; /* 35 Hz unless -framecap */
 	
-	do {
-		newtime = get_TimeCount();
-		tics = newtime - lasttimecount;
-	} while (tics <= ticcount);
+/* sleep off whatever is left of the frame rather than spinning */
+	WaitTimeCount(lasttimecount + ticcount);
+	
+	newtime = get_TimeCountFrac(&frac);
+	tics = newtime - lasttimecount;
 	
 	lasttimecount = newtime;
+	ticfrac = frac;
 	
 	if (demoplayback || demorecord)
 		tics = DEMOTICS;
@@ -340,266 +354,502 @@ configend:
 	return 0;
 }
 
-int SaveTheGame(const char *fn, const char *tag, int dx, int dy)
+/*
+==========================
+=
+= Savegame format
+=
+= A 64 byte header (GAMEHDR, SAVTYPE, version, GAMETYPE, time, payload
+= length, CRC32 of the payload, 32 byte name) followed by a list of
+= sections, each a four character id and a length.  Everything is
+= little-endian and is built in memory, so a save is one write, to a
+= temporary file that replaces the old save only once it is complete, and
+= a load is one read.  Version 0 files from older builds still load.
+=
+==========================
+*/
+
+#define SAVEVERSION	1
+#define SAVEHDRSIZE	64
+
+#define OBJRECSIZE	(21*4+2)
+#define STATRECSIZE	8
+#define DOORRECSIZE	9
+
+static int BeginSection(membuf_t *mb, const char *id)
 {
-	objtype *ob;
-	int fd, i, x, y;
-	int32_t cs;
-	
-	fd = OpenWrite(fn);
-	
-	if (fd != -1) {
-		WriteBytes(fd, (byte *)GAMEHDR, 8);
-		WriteBytes(fd, (byte *)SAVTYPE, 4);
-		WriteInt32(fd, 0x00000000); /* write version */
-		WriteBytes(fd, (byte *)GAMETYPE, 4);
-	
-		WriteInt32(fd, time(NULL));
-		WriteInt32(fd, 0x00000000);
-	
-		WriteInt32(fd, 0x00000000); /* write checksum (placeholder) */
-	
-		WriteBytes(fd, (byte *)tag, 32); /* write savegame name */
-	
-		DiskFlopAnim(dx, dy);
-	
-		WriteInt32(fd, gamestate.difficulty);
-		WriteInt32(fd, gamestate.mapon);
-		WriteInt32(fd, gamestate.oldscore);
-		WriteInt32(fd, gamestate.score);
-		WriteInt32(fd, gamestate.nextextra);
-		WriteInt32(fd, gamestate.lives);
-		WriteInt32(fd, gamestate.health);
-		WriteInt32(fd, gamestate.ammo);
-		WriteInt32(fd, gamestate.keys);
-		WriteInt32(fd, gamestate.bestweapon);
-		WriteInt32(fd, gamestate.weapon);
-		WriteInt32(fd, gamestate.chosenweapon);
-		WriteInt32(fd, gamestate.faceframe);
-		WriteInt32(fd, gamestate.attackframe);
-		WriteInt32(fd, gamestate.attackcount);
-		WriteInt32(fd, gamestate.weaponframe);
-		WriteInt32(fd, gamestate.episode);
-		WriteInt32(fd, gamestate.secretcount);
-		WriteInt32(fd, gamestate.treasurecount);
-		WriteInt32(fd, gamestate.killcount);
-		WriteInt32(fd, gamestate.secrettotal);
-		WriteInt32(fd, gamestate.treasuretotal);
-		WriteInt32(fd, gamestate.killtotal);
-		WriteInt32(fd, gamestate.TimeCount);
-		WriteInt32(fd, gamestate.killx);
-		WriteInt32(fd, gamestate.killy);
-		WriteInt8(fd, gamestate.victoryflag);
-	
-		DiskFlopAnim(dx, dy);
-	
-#ifdef SPEAR
-		for (i = 0; i < 20; i++) {
-#else
-		for (i = 0; i < 8; i++) {
-#endif
-			WriteInt32(fd, LevelRatios[i].kill);
-			WriteInt32(fd, LevelRatios[i].secret);
-			WriteInt32(fd, LevelRatios[i].treasure);
-			WriteInt32(fd, LevelRatios[i].time);
-		}
-	
-		DiskFlopAnim(dx, dy);
-	
-		WriteBytes(fd, (byte *)tilemap, 64*64); /* MAPSIZE * MAPSIZE */
-	
-		DiskFlopAnim(dx, dy);
-	
-		for (x = 0; x < 64; x++)
-			for (y = 0; y < 64; y++)
-				WriteInt32(fd, actorat[x][y]);
-	
-		DiskFlopAnim(dx, dy);
-			
-		WriteBytes(fd, (byte *)areaconnect, 37*37); /* NUMAREAS * NUMAREAS */
-	
-		DiskFlopAnim(dx, dy);
-	
-		for (i = 0; i < 37; i++)
-			WriteInt8(fd, areabyplayer[i]);
-	
-		for (ob = player; ob; ob = ob->next) {
-			DiskFlopAnim(dx, dy);
-			
-			WriteInt32(fd, ob->id);
-			WriteInt32(fd, ob->active);
-			WriteInt32(fd, ob->ticcount);
-			WriteInt32(fd, ob->obclass);
-			WriteInt32(fd, ob->state);
-			WriteInt8(fd,  ob->flags);
-			WriteInt32(fd, ob->distance);
-			WriteInt32(fd, ob->dir);
-			WriteInt32(fd, ob->x);
-			WriteInt32(fd, ob->y);
-			WriteInt32(fd, ob->tilex);
-			WriteInt32(fd, ob->tiley);
-			WriteInt8(fd,  ob->areanumber);
-			WriteInt32(fd, ob->viewx);
-			WriteInt32(fd, ob->viewheight);
-			WriteInt32(fd, ob->transx);
-			WriteInt32(fd, ob->transy);
-			WriteInt32(fd, ob->angle);
-			WriteInt32(fd, ob->hitpoints);
-			WriteInt32(fd, ob->speed);
-			WriteInt32(fd, ob->temp1);
-			WriteInt32(fd, ob->temp2);
-			WriteInt32(fd, ob->temp3);
-		}	
-		
-		WriteInt32(fd, 0xFFFFFFFF); /* end of actor list */
-		
-		DiskFlopAnim(dx, dy);
-		
-		WriteInt32(fd, laststatobj - statobjlist); /* ptr offset */
-
-		for (i = 0; i < 400; i++) { /* MAXSTATS */
-			WriteInt8(fd,  statobjlist[i].tilex);
-			WriteInt8(fd,  statobjlist[i].tiley);
-			WriteInt32(fd, statobjlist[i].shapenum);
-			WriteInt8(fd,  statobjlist[i].flags);
-			WriteInt8(fd,  statobjlist[i].itemnumber);
-		}
-	
-		DiskFlopAnim(dx, dy);
-	
-		for (i = 0; i < 64; i++) { /* MAXDOORS */
-			WriteInt32(fd, doorposition[i]);
+	MemWriteBytes(mb, (const byte *)id, 4);
+	MemWriteInt32(mb, 0);
+
+	return mb->pos;
+}
+
+static void EndSection(membuf_t *mb, int start)
+{
+	MemWriteAt32(mb, start - 4, mb->pos - start);
+}
+
+static boolean FindSection(membuf_t *file, const char *id, membuf_t *sec)
+{
+	int pos, len;
+
+	pos = SAVEHDRSIZE;
+	while (pos + 8 <= file->size) {
+		file->pos = pos + 4;
+		len = MemReadInt32(file);
+		if (len < 0 || len > file->size - pos - 8)
+			return false;
+
+		if (!strncmp((char *)file->data + pos, id, 4)) {
+			MemOpenRead(sec, file->data + pos + 8, len);
+			return true;
 		}
-	
-		DiskFlopAnim(dx, dy);
-	
-		for (i = 0; i < 64; i++) { /* MAXDOORS */
-			WriteInt8(fd,  doorobjlist[i].tilex);
-			WriteInt8(fd,  doorobjlist[i].tiley);
-			WriteInt8(fd,  doorobjlist[i].vertical);
-			WriteInt8(fd,  doorobjlist[i].lock);
-			WriteInt8(fd,  doorobjlist[i].action);
-			WriteInt32(fd, doorobjlist[i].ticcount);
+
+		pos += 8 + len;
+	}
+
+	return false;
+}
+
+static void WriteGameSections(membuf_t *mb, int dx, int dy)
+{
+	objtype *ob;
+	int sec, count, i, x, y;
+
+	sec = BeginSection(mb, "GAME");
+	MemWriteInt32(mb, gamestate.difficulty);
+	MemWriteInt32(mb, gamestate.mapon);
+	MemWriteInt32(mb, gamestate.oldscore);
+	MemWriteInt32(mb, gamestate.score);
+	MemWriteInt32(mb, gamestate.nextextra);
+	MemWriteInt32(mb, gamestate.lives);
+	MemWriteInt32(mb, gamestate.health);
+	MemWriteInt32(mb, gamestate.ammo);
+	MemWriteInt32(mb, gamestate.keys);
+	MemWriteInt32(mb, gamestate.bestweapon);
+	MemWriteInt32(mb, gamestate.weapon);
+	MemWriteInt32(mb, gamestate.chosenweapon);
+	MemWriteInt32(mb, gamestate.faceframe);
+	MemWriteInt32(mb, gamestate.attackframe);
+	MemWriteInt32(mb, gamestate.attackcount);
+	MemWriteInt32(mb, gamestate.weaponframe);
+	MemWriteInt32(mb, gamestate.episode);
+	MemWriteInt32(mb, gamestate.secretcount);
+	MemWriteInt32(mb, gamestate.treasurecount);
+	MemWriteInt32(mb, gamestate.killcount);
+	MemWriteInt32(mb, gamestate.secrettotal);
+	MemWriteInt32(mb, gamestate.treasuretotal);
+	MemWriteInt32(mb, gamestate.killtotal);
+	MemWriteInt32(mb, gamestate.TimeCount);
+	MemWriteInt32(mb, gamestate.killx);
+	MemWriteInt32(mb, gamestate.killy);
+	MemWriteInt8(mb,  gamestate.victoryflag);
+	EndSection(mb, sec);
+
+	sec = BeginSection(mb, "LVRT");
+	for (i = 0; i < NUMLEVELRATIOS; i++) {
+		MemWriteInt32(mb, LevelRatios[i].kill);
+		MemWriteInt32(mb, LevelRatios[i].secret);
+		MemWriteInt32(mb, LevelRatios[i].treasure);
+		MemWriteInt32(mb, LevelRatios[i].time);
+	}
+	EndSection(mb, sec);
+
+	DiskFlopAnim(dx, dy);
+
+	sec = BeginSection(mb, "TILE");
+	MemWriteBytes(mb, (byte *)tilemap, MAPSIZE*MAPSIZE);
+	EndSection(mb, sec);
+
+	/* actorat only ever holds 16 bit values (tiles, 0x80|door, 0x8000|id) */
+	sec = BeginSection(mb, "ACTR");
+	for (x = 0; x < MAPSIZE; x++)
+		for (y = 0; y < MAPSIZE; y++)
+			MemWriteInt16(mb, actorat[x][y]);
+	EndSection(mb, sec);
+
+	sec = BeginSection(mb, "AREA");
+	MemWriteBytes(mb, (byte *)areaconnect, NUMAREAS*NUMAREAS);
+	for (i = 0; i < NUMAREAS; i++)
+		MemWriteInt8(mb, areabyplayer[i]);
+	EndSection(mb, sec);
+
+	count = 0;
+	for (ob = player; ob; ob = ob->next)
+		count++;
+
+	sec = BeginSection(mb, "OBJS");
+	MemWriteInt32(mb, count);
+	for (ob = player; ob; ob = ob->next) {
+		MemWriteInt32(mb, ob->id);
+		MemWriteInt32(mb, ob->active);
+		MemWriteInt32(mb, ob->ticcount);
+		MemWriteInt32(mb, ob->obclass);
+		MemWriteInt32(mb, ob->state);
+		MemWriteInt8(mb,  ob->flags);
+		MemWriteInt32(mb, ob->distance);
+		MemWriteInt32(mb, ob->dir);
+		MemWriteInt32(mb, ob->x);
+		MemWriteInt32(mb, ob->y);
+		MemWriteInt32(mb, ob->tilex);
+		MemWriteInt32(mb, ob->tiley);
+		MemWriteInt8(mb,  ob->areanumber);
+		MemWriteInt32(mb, ob->viewx);
+		MemWriteInt32(mb, ob->viewheight);
+		MemWriteInt32(mb, ob->transx);
+		MemWriteInt32(mb, ob->transy);
+		MemWriteInt32(mb, ob->angle);
+		MemWriteInt32(mb, ob->hitpoints);
+		MemWriteInt32(mb, ob->speed);
+		MemWriteInt32(mb, ob->temp1);
+		MemWriteInt32(mb, ob->temp2);
+		MemWriteInt32(mb, ob->temp3);
+	}
+	EndSection(mb, sec);
+
+	DiskFlopAnim(dx, dy);
+
+	sec = BeginSection(mb, "STAT");
+	MemWriteInt32(mb, laststatobj - statobjlist);
+	for (i = 0; i < MAXSTATS; i++) {
+		MemWriteInt8(mb,  statobjlist[i].tilex);
+		MemWriteInt8(mb,  statobjlist[i].tiley);
+		MemWriteInt32(mb, statobjlist[i].shapenum);
+		MemWriteInt8(mb,  statobjlist[i].flags);
+		MemWriteInt8(mb,  statobjlist[i].itemnumber);
+	}
+	EndSection(mb, sec);
+
+	sec = BeginSection(mb, "DOOR");
+	for (i = 0; i < MAXDOORS; i++)
+		MemWriteInt32(mb, doorposition[i]);
+	for (i = 0; i < MAXDOORS; i++) {
+		MemWriteInt8(mb,  doorobjlist[i].tilex);
+		MemWriteInt8(mb,  doorobjlist[i].tiley);
+		MemWriteInt8(mb,  doorobjlist[i].vertical);
+		MemWriteInt8(mb,  doorobjlist[i].lock);
+		MemWriteInt8(mb,  doorobjlist[i].action);
+		MemWriteInt32(mb, doorobjlist[i].ticcount);
+	}
+	EndSection(mb, sec);
+
+	sec = BeginSection(mb, "PWAL");
+	MemWriteInt32(mb, pwallstate);
+	MemWriteInt32(mb, pwallx);
+	MemWriteInt32(mb, pwally);
+	MemWriteInt32(mb, pwalldir);
+	MemWriteInt32(mb, pwallpos);
+	EndSection(mb, sec);
+}
+
+int SaveTheGame(const char *fn, const char *tag, int dx, int dy)
+{
+	membuf_t mb;
+	char tmp[256];
+	int fd, ok;
+
+	DiskFlopAnim(dx, dy);
+
+	MemOpenWrite(&mb);
+
+	MemWriteBytes(&mb, (byte *)GAMEHDR, 8);
+	MemWriteBytes(&mb, (byte *)SAVTYPE, 4);
+	MemWriteInt32(&mb, SAVEVERSION);
+	MemWriteBytes(&mb, (byte *)GAMETYPE, 4);
+	MemWriteInt32(&mb, time(NULL));
+	MemWriteInt32(&mb, 0);		/* payload length */
+	MemWriteInt32(&mb, 0);		/* payload checksum */
+	MemWriteBytes(&mb, (byte *)tag, 32); /* write savegame name */
+
+	WriteGameSections(&mb, dx, dy);
+
+/* the old save stays put until the new one is safely on disk */
+	ok = !mb.error && strlen(fn) + 5 <= sizeof(tmp);
+	if (ok) {
+		MemWriteAt32(&mb, 24, mb.pos - SAVEHDRSIZE);
+		MemWriteAt32(&mb, 28, CalcCRC32(mb.data + SAVEHDRSIZE, mb.pos - SAVEHDRSIZE));
+
+		sprintf(tmp, "%s.tmp", fn);
+		fd = OpenWrite(tmp);
+		ok = fd != -1;
+		if (ok) {
+			ok = WriteBytes(fd, mb.data, mb.pos) == mb.pos;
+			ok = ok && !SyncWrite(fd);
+			ok = !CloseWrite(fd) && ok;
+
+			if (ok)
+				ok = !rename(tmp, fn);
+			if (!ok)
+				remove(tmp);
 		}
-	
-		DiskFlopAnim(dx, dy);
-	
-		WriteInt32(fd, pwallstate);
-		WriteInt32(fd, pwallx);
-		WriteInt32(fd, pwally);
-		WriteInt32(fd, pwalldir);
-		WriteInt32(fd, pwallpos);
+	}
 
-		DiskFlopAnim(dx, dy);
+	MemClose(&mb);
 
-		CloseWrite(fd);
+	DiskFlopAnim(dx, dy);
 
-		fd = OpenRead(fn);
-		ReadSeek(fd, 64, SEEK_SET);
-		cs = CalcFileChecksum(fd, ReadLength(fd) - 64);
-		CloseRead(fd);
-		
-		fd = OpenWriteAppend(fn);
-		WriteSeek(fd, 28, SEEK_SET);
-		WriteInt32(fd, cs);
-		
-		CloseWrite(fd);
-	} else {
-		Message(STR_NOSPACE1"\n"
-			STR_NOSPACE2);
-			
-		IN_ClearKeysDown();
-		IN_Ack();
-		
-		return -1;
+	if (ok) {
+		KeepSaveSnapshot(fn);
+		return 0;
 	}
-	
-	return 0;
+
+	Message(STR_NOSPACE1"\n"
+		STR_NOSPACE2);
+
+	IN_ClearKeysDown();
+	IN_Ack();
+
+	return -1;
 }
 
-int ReadSaveTag(const char *fn, const char *tag)
+/*
+==========================
+=
+= CheckSaveFile
+=
+= Reads the whole file into *data and validates the header and checksum.
+= Returns the format version (0 for old saves) or -1 if it is unusable.
+=
+==========================
+*/
+
+static int CheckSaveFile(int fd, byte **data, membuf_t *file, char *tag)
 {
 	char buf[8];
-	int fd;
-	int32_t v;
-	
-	fd = OpenRead(fn);
-	if (fd == -1)
-		goto rstfail;
-	
-	ReadBytes(fd, (byte *)buf, 8);
+	int32_t version, length;
+	uint32_t cs;
+	int len;
+
+	len = ReadWholeFile(fd, data);
+	if (len < SAVEHDRSIZE)
+		return -1;
+
+	MemOpenRead(file, *data, len);
+
+	MemReadBytes(file, (byte *)buf, 8);
 	if (strncmp(buf, GAMEHDR, 8))
-		goto rstfail;
-	
-	ReadBytes(fd, (byte *)buf, 4);
+		return -1;
+
+	MemReadBytes(file, (byte *)buf, 4);
 	if (strncmp(buf, SAVTYPE, 4))
-		goto rstfail;
-	
-	v = ReadInt32(fd);
-	if (v != 0xFFFFFFFF && v != 0x00000000) /* -1 and 0 are the same */
-		goto rstfail;
-	
-	ReadBytes(fd, (byte *)buf, 4);
+		return -1;
+
+	version = MemReadInt32(file);
+
+	MemReadBytes(file, (byte *)buf, 4);
 	if (strncmp(buf, GAMETYPE, 4))
-		goto rstfail;
-	
-	ReadInt32(fd);
-	ReadInt32(fd);
-	
-	v = ReadInt32(fd); /* get checksum */
-	
-	ReadSeek(fd, 64, SEEK_SET);
-	if (v != CalcFileChecksum(fd, ReadLength(fd) - 64))
-		goto rstfail;
-	
-	ReadSeek(fd, 32, SEEK_SET);
-	ReadBytes(fd, (byte *)tag, 32);
-		
-	CloseRead(fd);
-	
-	return 0;
-rstfail:
-	if (fd != -1)
-		CloseRead(fd);
-	
-	return -1;
+		return -1;
+
+	MemReadInt32(file);
+	length = MemReadInt32(file);
+	cs = MemReadInt32(file);
+
+	if (tag)
+		MemReadBytes(file, (byte *)tag, 32);
+
+	if (version == -1 || version == 0) { /* -1 and 0 are the same */
+		ReadSeek(fd, SAVEHDRSIZE, SEEK_SET);
+		if ((int32_t)cs != CalcFileChecksum(fd, len - SAVEHDRSIZE))
+			return -1;
+		return 0;
+	}
+
+	if (version != SAVEVERSION || length != len - SAVEHDRSIZE)
+		return -1;
+
+	if (cs != CalcCRC32(*data + SAVEHDRSIZE, length))
+		return -1;
+
+	return version;
 }
 
-int LoadTheGame(const char *fn, int dx, int dy)
+int ReadSaveTag(const char *fn, const char *tag)
 {
-	char buf[8];
-	int fd, i, x, y, id;
-	int32_t v;
-	
-	fd = OpenRead(fn);
+	membuf_t file;
+	byte *data = NULL;
+	int fd, version;
 
+	fd = OpenRead(fn);
 	if (fd == -1)
-		goto loadfail;
-	
-	ReadBytes(fd, (byte *)buf, 8);
-	if (strncmp(buf, GAMEHDR, 8))
-		goto loadfail;
-	
-	ReadBytes(fd, (byte *)buf, 4);
-	if (strncmp(buf, SAVTYPE, 4))
-		goto loadfail;
-	
-	v = ReadInt32(fd);
-	if (v != 0xFFFFFFFF && v != 0x00000000) /* -1 and 0 are the same */
-		goto loadfail;
-	
-	ReadBytes(fd, (byte *)buf, 4);
-	if (strncmp(buf, GAMETYPE, 4))
-		goto loadfail;
-	
-	ReadInt32(fd);
-	ReadInt32(fd);
-	
-	v = ReadInt32(fd); /* get checksum */
-	
-	ReadSeek(fd, 64, SEEK_SET);
-	if (v != CalcFileChecksum(fd, ReadLength(fd) - 64))
-		goto loadfail;
+		return -1;
+
+	version = CheckSaveFile(fd, &data, &file, (char *)tag);
+
+	CloseRead(fd);
+	free(data);
+
+	return (version == -1) ? -1 : 0;
+}
+
+static int LoadGameSections(membuf_t *file, int dx, int dy)
+{
+	membuf_t game, ratios, tiles, actors, areas, objs, stats, doors, pwall;
+	int idmap[MAXACTORS];
+	int count, last, id, i, x, y;
+	unsigned v;
+	objtype *ob;
+
+/* find everything and check the sizes before touching the world */
+	if (!FindSection(file, "GAME", &game) || game.size != 26*4+1)
+		return -1;
+	if (!FindSection(file, "LVRT", &ratios) || ratios.size != NUMLEVELRATIOS*16)
+		return -1;
+	if (!FindSection(file, "TILE", &tiles) || tiles.size != MAPSIZE*MAPSIZE)
+		return -1;
+	if (!FindSection(file, "ACTR", &actors) || actors.size != MAPSIZE*MAPSIZE*2)
+		return -1;
+	if (!FindSection(file, "AREA", &areas) || areas.size != NUMAREAS*NUMAREAS+NUMAREAS)
+		return -1;
+	if (!FindSection(file, "STAT", &stats) || stats.size != 4+MAXSTATS*STATRECSIZE)
+		return -1;
+	if (!FindSection(file, "DOOR", &doors) || doors.size != MAXDOORS*4+MAXDOORS*DOORRECSIZE)
+		return -1;
+	if (!FindSection(file, "PWAL", &pwall) || pwall.size != 5*4)
+		return -1;
+	if (!FindSection(file, "OBJS", &objs))
+		return -1;
+
+	count = MemReadInt32(&objs);
+	if (count < 1 || count > MAXACTORS || objs.size != 4+count*OBJRECSIZE)
+		return -1;
+
+	last = MemReadInt32(&stats);
+	if (last < 0 || last > MAXSTATS)
+		return -1;
+
+	DiskFlopAnim(dx, dy);
+
+	gamestate.difficulty	= MemReadInt32(&game);
+	gamestate.mapon		= MemReadInt32(&game);
+	gamestate.oldscore	= MemReadInt32(&game);
+	gamestate.score		= MemReadInt32(&game);
+	gamestate.nextextra	= MemReadInt32(&game);
+	gamestate.lives		= MemReadInt32(&game);
+	gamestate.health	= MemReadInt32(&game);
+	gamestate.ammo		= MemReadInt32(&game);
+	gamestate.keys		= MemReadInt32(&game);
+	gamestate.bestweapon	= MemReadInt32(&game);
+	gamestate.weapon	= MemReadInt32(&game);
+	gamestate.chosenweapon	= MemReadInt32(&game);
+	gamestate.faceframe	= MemReadInt32(&game);
+	gamestate.attackframe	= MemReadInt32(&game);
+	gamestate.attackcount	= MemReadInt32(&game);
+	gamestate.weaponframe	= MemReadInt32(&game);
+	gamestate.episode	= MemReadInt32(&game);
+	gamestate.secretcount	= MemReadInt32(&game);
+	gamestate.treasurecount	= MemReadInt32(&game);
+	gamestate.killcount	= MemReadInt32(&game);
+	gamestate.secrettotal	= MemReadInt32(&game);
+	gamestate.treasuretotal = MemReadInt32(&game);
+	gamestate.killtotal	= MemReadInt32(&game);
+	gamestate.TimeCount	= MemReadInt32(&game);
+	gamestate.killx		= MemReadInt32(&game);
+	gamestate.killy		= MemReadInt32(&game);
+	gamestate.victoryflag	= MemReadInt8(&game);
+
+	for (i = 0; i < NUMLEVELRATIOS; i++) {
+		LevelRatios[i].kill	= MemReadInt32(&ratios);
+		LevelRatios[i].secret	= MemReadInt32(&ratios);
+		LevelRatios[i].treasure	= MemReadInt32(&ratios);
+		LevelRatios[i].time	= MemReadInt32(&ratios);
+	}
+
+	SetupGameLevel();
+
+	DiskFlopAnim(dx, dy);
+
+	MemReadBytes(&tiles, (byte *)tilemap, MAPSIZE*MAPSIZE);
+	MemReadBytes(&areas, (byte *)areaconnect, NUMAREAS*NUMAREAS);
+	for (i = 0; i < NUMAREAS; i++)
+		areabyplayer[i] = MemReadInt8(&areas);
+
+	InitActorList();
+
+	for (i = 0; i < MAXACTORS; i++)
+		idmap[i] = -1;
+
+	for (i = 0; i < count; i++) {
+		if (i)
+			GetNewActor();
+		ob = i ? new : player; /* player ptr already set up */
+
+		id = MemReadInt32(&objs);
+		if (id >= 0 && id < MAXACTORS)
+			idmap[id] = ob->id;
+
+		ob->active		= MemReadInt32(&objs);
+		ob->ticcount		= MemReadInt32(&objs);
+		ob->obclass		= MemReadInt32(&objs);
+		ob->state		= MemReadInt32(&objs);
+		ob->flags		= MemReadInt8(&objs);
+		ob->distance		= MemReadInt32(&objs);
+		ob->dir			= MemReadInt32(&objs);
+		ob->x			= MemReadInt32(&objs);
+		ob->y			= MemReadInt32(&objs);
+		ob->tilex		= MemReadInt32(&objs);
+		ob->tiley		= MemReadInt32(&objs);
+		ob->areanumber		= MemReadInt8(&objs);
+		ob->viewx		= MemReadInt32(&objs);
+		ob->viewheight		= MemReadInt32(&objs);
+		ob->transx		= MemReadInt32(&objs);
+		ob->transy		= MemReadInt32(&objs);
+		ob->angle		= MemReadInt32(&objs);
+		ob->hitpoints		= MemReadInt32(&objs);
+		ob->speed		= MemReadInt32(&objs);
+		ob->temp1		= MemReadInt32(&objs);
+		ob->temp2		= MemReadInt32(&objs);
+		ob->temp3		= MemReadInt32(&objs);
+	}
+
+/* one pass to move the saved actor ids over to the new ones */
+	for (x = 0; x < MAPSIZE; x++)
+		for (y = 0; y < MAPSIZE; y++) {
+			v = (uint16_t)MemReadInt16(&actors);
+			if (v & 0x8000) {
+				id = v & 0x7FFF;
+				v = (id < MAXACTORS && idmap[id] != -1) ? (idmap[id] | 0x8000) : 0;
+			}
+			actorat[x][y] = v;
+		}
+
+	DiskFlopAnim(dx, dy);
+
+	laststatobj = statobjlist + last;
+	for (i = 0; i < MAXSTATS; i++) {
+		statobjlist[i].tilex		= MemReadInt8(&stats);
+		statobjlist[i].tiley		= MemReadInt8(&stats);
+		statobjlist[i].shapenum		= MemReadInt32(&stats);
+		statobjlist[i].flags		= MemReadInt8(&stats);
+		statobjlist[i].itemnumber	= MemReadInt8(&stats);
+		statobjlist[i].visspot 		= &spotvis[statobjlist[i].tilex][statobjlist[i].tiley];
+	}
+
+	for (i = 0; i < MAXDOORS; i++)
+		doorposition[i]		= MemReadInt32(&doors);
+	for (i = 0; i < MAXDOORS; i++) {
+		doorobjlist[i].tilex	= MemReadInt8(&doors);
+		doorobjlist[i].tiley	= MemReadInt8(&doors);
+		doorobjlist[i].vertical = MemReadInt8(&doors);
+		doorobjlist[i].lock	= MemReadInt8(&doors);
+		doorobjlist[i].action	= MemReadInt8(&doors);
+		doorobjlist[i].ticcount	= MemReadInt32(&doors);
+	}
+
+	pwallstate 	= MemReadInt32(&pwall);
+	pwallx		= MemReadInt32(&pwall);
+	pwally		= MemReadInt32(&pwall);
+	pwalldir	= MemReadInt32(&pwall);
+	pwallpos	= MemReadInt32(&pwall);
+
+	DiskFlopAnim(dx, dy);
+
+	return 0;
+}
+
+/* version 0 saves, written one field at a time */
+static int LoadLegacyGame(int fd, int dx, int dy)
+{
+	int i, x, y, id;
 	
 	ReadSeek(fd, 64, SEEK_SET);
 	
@@ -784,13 +1034,43 @@ int LoadTheGame(const char *fn, int dx, int dy)
 
 	DiskFlopAnim(dx, dy);
 	
-	CloseRead(fd);	
+	return 0;
+}
+
+int LoadTheGame(const char *fn, int dx, int dy)
+{
+	membuf_t file;
+	byte *data = NULL;
+	int fd, version;
+	
+	if (RestoreSaveSnapshot(fn))
+		return 0;
+
+	fd = OpenRead(fn);
+
+	if (fd == -1)
+		goto loadfail;
+	
+	version = CheckSaveFile(fd, &data, &file, NULL);
+	
+	if (version == 0) {
+		free(data);
+		data = NULL;
+		
+		if (LoadLegacyGame(fd, dx, dy))
+			goto loadfail;
+	} else if (version != SAVEVERSION || LoadGameSections(&file, dx, dy))
+		goto loadfail;
+	
+	CloseRead(fd);
+	free(data);
 	
 	return 0;
 	
 loadfail:
 	if (fd != -1)
 		CloseRead(fd);
+	free(data);
 		
 	Message(STR_SAVECHT1"\n"
 		STR_SAVECHT2"\n"
@@ -1178,7 +1458,8 @@ void InitGame()
 	CA_Startup();
 	VW_Startup();
 	IN_Startup();
-	SD_Startup();
+	if (!timedemo || MS_CheckParm("wavout") || MS_CheckParm("sndsink"))
+		SD_Startup();
 	US_Startup();
 	
 //
@@ -1201,6 +1482,8 @@ void InitGame()
 			
 	BuildTables();
 	SetupWalls();
+	SetupWallPages();
+	InitStateLinks();
 
 	NewViewSize(viewsize);
 
@@ -1241,20 +1524,28 @@ void DemoLoop()
 	
 	StartCPMusic(INTROSONG);
 
-	if (!NoWait)
+	if (!NoWait && !timedemo)
 		PG13();
 
 	i = MS_CheckParm("playdemo");
 	if (i && ((i+1) < _argc)) {
+		int seek = MS_CheckParm("demoseek");
+		
+		if (seek && ((seek+1) < _argc))
+			demoseekto = atol(_argv[seek+1]);
+			
 		i++;
 		for (; i < _argc; i++) {
 			if (_argv[i][0] == '-')
 				break;
 			IN_ClearKeysDown();
-			if (PlayDemoFromFile(_argv[i]))
+			if (PlayDemoFromFile(_argv[i]) && !timedemo)
 				IN_UserInput(3 * 70);
 		}
+		if (timedemo)
+			Quit(NULL);
 		VW_FadeOut();
+		demoseekto = 0;
 	}
 	
 	if (MS_CheckParm("demotest")) {
@@ -1358,6 +1649,8 @@ void DemoLoop()
 
 int WolfMain(int argc, char *argv[])
 {
+	int i;
+	
 	_argc = argc;
 	_argv = argv;
 
@@ -1365,13 +1658,32 @@ int WolfMain(int argc, char *argv[])
 		printf("Game: %s\n", GAMENAME);
 		Quit(NULL);
 	}
+	
+	if (MS_CheckParm("clocktest"))
+		ClockTest();
+	if (MS_CheckParm("xformbench"))
+		TransformBench();
 		
 	printf("Now Loading %s\n", GAMENAME);
 		
 	CheckForEpisodes();
 
+	simonly = MS_CheckParm("simonly") && MS_CheckParm("playdemo");
+	timedemo = simonly || (MS_CheckParm("timedemo") && MS_CheckParm("playdemo"));
+
+	i = MS_CheckParm("framecap");
+	if (i && i + 1 < _argc) {
+		/* whole tics only: 70 fps, 35, 23, 17... */
+		i = atoi(_argv[i+1]);
+		if (i > 0)
+			frametics = (70 + i - 1) / i;
+	}
+
 	InitGame();
 
+	if (MS_CheckParm("oplbench"))
+		SD_OPLBench();
+
 	DemoLoop();
 
 	Quit("Demo loop exited???");
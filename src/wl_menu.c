@@ -1372,6 +1372,7 @@ int CalibrateJoystick()
 	do {
 		jb=IN_JoyButtons();
 		IN_CheckAck(); /* force update */
+		IdleWait();
 		if (IN_KeyDown(sc_Escape))
 			return 0;
 		
@@ -1402,6 +1403,7 @@ int CalibrateJoystick()
 	do {
 		jb = IN_JoyButtons();
 		IN_CheckAck(); /* force update */
+		IdleWait();
 		if (IN_KeyDown(sc_Escape))
 			return 0;
 		if (IN_KeyDown(sc_Tab) && IN_KeyDown(sc_P) && MS_CheckParm("debugmode"))
@@ -1413,6 +1415,7 @@ int CalibrateJoystick()
 
 	do {
 		IN_CheckAck();
+		IdleWait();
 	} while (IN_JoyButtons());
 
 	//
@@ -2869,7 +2872,7 @@ void DrawHalfStep(int x,int y)
 	VW_UpdateScreen();
 	SD_PlaySound(MOVEGUN1SND);
 	set_TimeCount(0);
-	while(get_TimeCount() < 8);
+	WaitTimeCount(8);
 }
 
 
@@ -2983,6 +2986,7 @@ void ReadAnyControl(ControlInfo *ci)
 {
 	int mouseactive=0;
 
+	IdleWait();	/* menus only poll, so don't burn the CPU doing it */
 	IN_ReadControl(0,ci);
 
 	if (mouseenabled)
@@ -3017,6 +3021,7 @@ int Confirm(const char *string)
 	do
 	{
 		IN_CheckAck(); /* force update */
+		IdleWait();
 		if (get_TimeCount() >= 10)
 		{
 			switch(tick)
@@ -19,7 +19,7 @@ objtype 	objlist[MAXACTORS],*new,*obj,*player,*lastobj,
 
 unsigned	farmapylookup[MAPSIZE];
 
-boolean		singlestep,godmode,noclip;
+boolean		singlestep,godmode,noclip,profiling;
 
 byte		tilemap[MAPSIZE][MAPSIZE];	// wall values only
 byte		spotvis[MAPSIZE][MAPSIZE];
@@ -469,7 +469,7 @@ void PollControls()
 		*demoptr++ = controly;
 
 		if (demoptr >= lastdemoptr)
-			Quit("Demo buffer overflowed!");
+			DemoChunkFull();
 
 		controlx *= (int)tics;
 		controly *= (int)tics;
@@ -1078,7 +1078,7 @@ void FinishPaletteShifts()
 
 void DoActor(objtype *ob)
 {
-	void (*think)(objtype *);
+	statelink_t *link;
 
 	if (!ob->active && !areabyplayer[ob->areanumber])
 		return;
@@ -1092,10 +1092,9 @@ void DoActor(objtype *ob)
 
 	if (!ob->ticcount)
 	{
-		think =	gamestates[ob->state].think;
-		if (think)
+		if (statelinks[ob->state].flags & SL_THINK)
 		{
-			think(ob);
+			gamestates[ob->state].think(ob);
 			if (ob->state == s_none)
 			{
 				RemoveObj (ob);
@@ -1119,18 +1118,19 @@ void DoActor(objtype *ob)
 	ob->ticcount-=tics;
 	while (ob->ticcount <= 0)
 	{
-		think = gamestates[ob->state].action;	// end of state action
-		if (think)
+		link = &statelinks[ob->state];
+		if (link->flags & SL_ACTION)
 		{
-			think(ob);
+			gamestates[ob->state].action(ob);	// end of state action
 			if (ob->state == s_none)
 			{
 				RemoveObj(ob);
 				return;
 			}
+			link = &statelinks[ob->state];		// action may change state
 		}
 
-		ob->state = gamestates[ob->state].next;
+		ob->state = link->next;
 
 		if (ob->state == s_none)
 		{
@@ -1138,23 +1138,22 @@ void DoActor(objtype *ob)
 			return;
 		}
 
-		if (!gamestates[ob->state].tictime)
+		if (!link->nexttics)
 		{
 			ob->ticcount = 0;
 			goto think;
 		}
 
-		ob->ticcount += gamestates[ob->state].tictime;
+		ob->ticcount += link->nexttics;
 	}
 
 think:
 	//
 	// think
 	//
-	think =	gamestates[ob->state].think;
-	if (think)
+	if (statelinks[ob->state].flags & SL_THINK)
 	{
-		think(ob);
+		gamestates[ob->state].think(ob);
 		if (ob->state == s_none)
 		{
 			RemoveObj(ob);
@@ -1174,15 +1173,64 @@ think:
 //==========================================================================
 
 
+long funnyticount;
+
 /*
 ===================
 =
-= PlayLoop
+= PlayTic
+=
+= Moves the world on by one frame's worth of tics
 =
 ===================
 */
 
-long funnyticount;
+void PlayTic()
+{
+	/* handle input */
+	PollControls();
+
+//
+// actor thinking
+//
+	madenoise = false;
+
+	MoveDoors();
+	MovePWalls();
+
+	DoActor(player);
+	PrecheckSight();
+	for (obj = player->next; obj; obj = obj->next)
+		DoActor(obj);
+
+	if (!norender)
+		UpdatePaletteShifts();
+
+	ThreeDRefresh();
+
+	//
+	// MAKE FUNNY FACE IF BJ DOESN'T MOVE FOR AWHILE
+	//
+	#ifdef SPEAR
+	funnyticount += tics;
+	if (funnyticount > 30l*70)
+	{
+		funnyticount = 0;
+		StatusDrawPic (17,4,BJWAITING1PIC+(US_RndT()&1));
+		facecount = 0;
+	}
+	#endif
+
+	gamestate.TimeCount += tics;
+}
+
+/*
+===================
+=
+= PlayLoop
+=
+===================
+*/
 
 void PlayLoop()
 {
@@ -1203,43 +1251,32 @@ void PlayLoop()
 
 	set_TimeCount(0);
 	
+	if (demoplayback && demoseekto)
+		SeekDemo(demoseekto);
+
 	do
 	{
 		/* get timing info for last frame */
 		CalcTics();
 		
-		/* handle input */
-		PollControls();
-
-//
-// actor thinking
-//
-		madenoise = false;
-
-		MoveDoors();
-		MovePWalls();
-
-		for (obj = player; obj; obj = obj->next)
-			DoActor(obj);
-		
-		UpdatePaletteShifts();
-
-		ThreeDRefresh();
-
-		//
-		// MAKE FUNNY FACE IF BJ DOESN'T MOVE FOR AWHILE
-		//
-		#ifdef SPEAR
-		funnyticount += tics;
-		if (funnyticount > 30l*70)
-		{
-			funnyticount = 0;
-			StatusDrawPic (17,4,BJWAITING1PIC+(US_RndT()&1));
-			facecount = 0;
+		if (demoplayback)
+			DemoKeyframe();
+
+		if (timedemo) {
+			unsigned long t0;
+			
+			t0 = get_TimeStamp();
+			PlayTic();
+			DemoFrameTime(get_TimeStamp() - t0);
+
+			if (soundrender) {
+				UpdateSoundLoc(player->x, player->y, player->angle);
+				SD_RenderTics(tics);
+			}
+			continue;
 		}
-		#endif
 
-		gamestate.TimeCount += tics;
+		PlayTic();
 
  		UpdateSoundLoc(player->x, player->y, player->angle);
 
@@ -1261,8 +1298,14 @@ void PlayLoop()
 		{
 			if (IN_CheckAck())
 			{
+				if (LastScan == sc_PgUp)
+					SeekDemo(gamestate.TimeCount - 30l*TickBase);
+				else if (LastScan == sc_PgDn)
+					SeekDemo(gamestate.TimeCount + 30l*TickBase);
+				else
+					playstate = ex_abort;
+
 				IN_ClearKeysDown();
-				playstate = ex_abort;
 			}
 		}
 
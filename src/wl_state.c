@@ -1,5 +1,9 @@
 #include "wl_def.h"
 
+#ifdef _REENTRANT
+#include <pthread.h>
+#endif
+
 /*
 =============================================================================
 
@@ -295,6 +299,189 @@ boolean TryWalk(objtype *ob)
 	return true;
 }
 
+/*
+=============================================================================
+
+							FLOW FIELD
+
+With the "flowfield" parm, the distance from every tile to the player is
+found with a breadth first search the first time a chasing actor asks for
+it each tic.  All chasers share the one field, so each only has to look at
+its eight neighbours to find the way around walls.  Doors count as open and
+actors are ignored, TryWalk still has the final word on every step.
+
+The field changes how actors move, so it is never used for demos.
+
+=============================================================================
+*/
+
+#define FLOWUNSEEN	0xffff
+
+static	boolean		flowenabled;
+static	word		flowdist[MAPSIZE][MAPSIZE];
+static	long		flowtime;
+static	int			flowtilex,flowtiley;
+
+static	int			dirdx[8] = {1,1,0,-1,-1,-1,0,1};
+static	int			dirdy[8] = {0,-1,-1,-1,0,1,1,1};
+
+
+/*
+=====================
+=
+= InitFlowField
+=
+= Call at level setup
+=
+=====================
+*/
+
+void InitFlowField (void)
+{
+	flowenabled = MS_CheckParm("flowfield") && !demoplayback && !demorecord;
+	flowtime = -1;
+}
+
+
+/*
+=====================
+=
+= FlowWalkable
+=
+= Doors and actors do not stop the flow, walls and blocking statics do.
+= Diagonal steps need both side tiles free of walls and doors, as in TryWalk
+=
+=====================
+*/
+
+static boolean FlowWalkable (int x, int y, boolean diag)
+{
+	unsigned	temp;
+
+	if (x<0 || x>=MAPSIZE || y<0 || y>=MAPSIZE)
+		return false;
+
+	temp = actorat[x][y];
+	if (!temp || temp >= 256)
+		return true;
+	if (temp < 128 || diag)
+		return false;
+	return true;
+}
+
+static boolean FlowStep (int x, int y, int dir)
+{
+	int	dx,dy;
+
+	dx = dirdx[dir];
+	dy = dirdy[dir];
+
+	if (!dx || !dy)
+		return FlowWalkable (x+dx,y+dy,false);
+
+	return FlowWalkable (x+dx,y+dy,true)
+		&& FlowWalkable (x+dx,y,true)
+		&& FlowWalkable (x,y+dy,true);
+}
+
+
+/*
+=====================
+=
+= BuildFlowField
+=
+=====================
+*/
+
+static void BuildFlowField (void)
+{
+	word	queue[MAPSIZE*MAPSIZE];
+	int		head,tail;
+	int		x,y,dir,nx,ny;
+	word	dist;
+
+	memset (flowdist,0xff,sizeof(flowdist));
+
+	flowtime = gamestate.TimeCount;
+	flowtilex = player->tilex;
+	flowtiley = player->tiley;
+
+	flowdist[flowtilex][flowtiley] = 0;
+	queue[0] = (flowtilex<<6) + flowtiley;
+	head = 0;
+	tail = 1;
+
+	while (head < tail)
+	{
+		x = queue[head]>>6;
+		y = queue[head]&63;
+		head++;
+		dist = flowdist[x][y]+1;
+
+		for (dir=0;dir<8;dir++)
+		{
+			nx = x+dirdx[dir];
+			ny = y+dirdy[dir];
+			if (nx<0 || nx>=MAPSIZE || ny<0 || ny>=MAPSIZE
+			|| flowdist[nx][ny] != FLOWUNSEEN)
+				continue;
+			if (!FlowStep (x,y,dir))
+				continue;
+
+			flowdist[nx][ny] = dist;
+			queue[tail++] = (nx<<6) + ny;
+		}
+	}
+}
+
+
+/*
+=====================
+=
+= FlowDir
+=
+= Returns the direction of the neighbour closest to the player, or nodir if
+= the field is off or ob is cut off from the player
+=
+=====================
+*/
+
+static dirtype FlowDir (objtype *ob, dirtype turnaround)
+{
+	int		dir;
+	dirtype	best;
+	word	dist,bestdist;
+
+	if (!flowenabled)
+		return nodir;
+
+	if (flowtime != gamestate.TimeCount
+	|| flowtilex != player->tilex || flowtiley != player->tiley)
+		BuildFlowField ();
+
+	bestdist = flowdist[ob->tilex][ob->tiley];
+	if (bestdist == FLOWUNSEEN)
+		return nodir;
+
+	best = nodir;
+	for (dir=0;dir<8;dir++)
+	{
+		if (dir == turnaround)
+			continue;
+		if (!FlowStep (ob->tilex,ob->tiley,dir))
+			continue;
+
+		dist = flowdist[ob->tilex+dirdx[dir]][ob->tiley+dirdy[dir]];
+		if (dist < bestdist)
+		{
+			bestdist = dist;
+			best = dir;
+		}
+	}
+
+	return best;
+}
+
 /*
 ==================================
 =
@@ -337,8 +524,20 @@ void SelectDodgeDir(objtype *ob)
 	else
 		turnaround=opposite[ob->dir];
 
-	deltax = player->tilex - ob->tilex;
-	deltay = player->tiley - ob->tiley;
+	tdir = FlowDir (ob,nodir);
+	if (tdir != nodir)
+	{
+	//
+	// dodge along the way around the walls
+	//
+		deltax = dirdx[tdir];
+		deltay = dirdy[tdir];
+	}
+	else
+	{
+		deltax = player->tilex - ob->tilex;
+		deltay = player->tiley - ob->tiley;
+	}
 
 //
 // arange 5 direction choices in order of preference
@@ -443,6 +642,14 @@ void SelectChaseDir(objtype *ob)
 	olddir=ob->dir;
 	turnaround=opposite[olddir];
 
+	tdir = FlowDir (ob,turnaround);
+	if (tdir != nodir)
+	{
+		ob->dir = tdir;
+		if (TryWalk(ob))
+			return;
+	}
+
 	deltax=player->tilex - ob->tilex;
 	deltay=player->tiley - ob->tiley;
 
@@ -946,19 +1153,181 @@ void DamageActor (objtype *ob, unsigned damage)
 */
 
 
+/*
+=============================================================================
+
+A potentially visible set is built for every tile when the level is set up,
+with doors and pushable walls counted as open.  CheckLine can only succeed
+if the player's tile is in the set of the actor's tile, so most actors
+behind walls are rejected without tracing.
+
+Traced lines are remembered by their exact end points.  A line that never
+touched a door only depends on the walls and is kept until a pushwall moves,
+a line across a door is only good for the tic it was traced in.
+
+=============================================================================
+*/
+
+#define SIGHTCACHESIZE	1024		// must be a power of 2
+#define SIGHTWALLS		-1l			// stamp for lines that crossed no doors
+
+typedef struct
+{
+	unsigned	gen;
+	word		x1,y1,x2,y2,playertile;
+	long		stamp;
+	boolean		clear;
+} sightcache_t;
+
+static	byte			sightpvs[MAPSIZE*MAPSIZE][MAPSIZE*MAPSIZE/8];
+static	sightcache_t	sightcache[SIGHTCACHESIZE];
+static	unsigned		sightgen;
+
+long	sightchecks,sightculled,sightcached,sightprechecked;
+
+
 /*
 =====================
 =
-= CheckLine
+= SightQuadrant
 =
-= Returns true if a straight line between the player and ob is unobstructed
+= Marks every tile that can be reached from tx,ty by steps of sx, sy or both
+= without leaving open tiles
 =
 =====================
 */
 
-boolean CheckLine (objtype *ob)
+static void SightQuadrant (byte open[MAPSIZE][MAPSIZE],
+	byte reach[MAPSIZE][MAPSIZE], int tx, int ty, int sx, int sy)
+{
+	byte	quad[MAPSIZE][MAPSIZE];
+	int		x,y;
+	byte	c;
+
+	for (x=tx;x>=0 && x<MAPSIZE;x+=sx)
+		for (y=ty;y>=0 && y<MAPSIZE;y+=sy)
+		{
+			if (x==tx && y==ty)
+				c = 1;
+			else if (!open[x][y])
+				c = 0;
+			else
+				c = (x!=tx && quad[x-sx][y])
+				|| (y!=ty && quad[x][y-sy])
+				|| (x!=tx && y!=ty && quad[x-sx][y-sy]);
+
+			quad[x][y] = c;
+			reach[x][y] |= c;
+		}
+}
+
+
+/*
+=====================
+=
+= InitSightCache
+=
+= Builds the potentially visible sets for the current level and flushes the
+= line cache.  Call after the tilemap is final and the ambush tiles are gone.
+=
+= CheckLine walks one tile per column when the line is more horizontal than
+= vertical (one per row otherwise), and the row it samples moves at most one
+= tile per column, toward the player.  So a clear line always has a chain of
+= open tiles from the actor that only steps away from it, ending next to the
+= player.  Any tile next to such a chain goes into the set.
+=
+=====================
+*/
+
+void InitSightCache (void)
+{
+	byte	open[MAPSIZE][MAPSIZE];
+	byte	reach[MAPSIZE][MAPSIZE];
+	byte	near[MAPSIZE][MAPSIZE];
+	byte	*vis;
+	word	*info;
+	int		x,y,tx,ty,tile;
+
+	memset (sightcache,0,sizeof(sightcache));
+	sightgen = 1;
+	sightchecks = sightculled = sightcached = sightprechecked = 0;
+
+	info = mapsegs[1];
+	for (y=0;y<MAPSIZE;y++)
+		for (x=0;x<MAPSIZE;x++)
+			open[x][y] = !tilemap[x][y] || (tilemap[x][y] & 0x80)
+				|| info[farmapylookup[y]+x] == PUSHABLETILE;
+
+	for (tx=0;tx<MAPSIZE;tx++)
+		for (ty=0;ty<MAPSIZE;ty++)
+		{
+			vis = sightpvs[(tx<<6)+ty];
+
+			if (!open[tx][ty])
+			{
+				memset (vis,0xff,sizeof(sightpvs[0]));	// always trace
+				continue;
+			}
+
+			memset (reach,0,sizeof(reach));
+			SightQuadrant (open,reach,tx,ty,1,1);
+			SightQuadrant (open,reach,tx,ty,1,-1);
+			SightQuadrant (open,reach,tx,ty,-1,1);
+			SightQuadrant (open,reach,tx,ty,-1,-1);
+
+			//
+			// grow the reached tiles by one in every direction
+			//
+			for (x=0;x<MAPSIZE;x++)
+				for (y=0;y<MAPSIZE;y++)
+					near[x][y] = reach[x][y]
+						| (y>0 && reach[x][y-1])
+						| (y<MAPSIZE-1 && reach[x][y+1]);
+
+			memset (vis,0,sizeof(sightpvs[0]));
+			for (x=0;x<MAPSIZE;x++)
+				for (y=0;y<MAPSIZE;y++)
+					if (near[x][y]
+					|| (x>0 && near[x-1][y])
+					|| (x<MAPSIZE-1 && near[x+1][y]) )
+					{
+						tile = (x<<6)+y;
+						vis[tile>>3] |= 1<<(tile&7);
+					}
+		}
+}
+
+
+/*
+=====================
+=
+= InvalidateSightCache
+=
+= Call whenever the walls in tilemap change
+=
+=====================
+*/
+
+void InvalidateSightCache (void)
+{
+	sightgen++;
+}
+
+
+/*
+=====================
+=
+= TraceLine
+=
+= Returns true if a straight line between the player and x1,y1 (1/256 tile
+= precision) is unobstructed.  door is set if the line touched a door.
+=
+=====================
+*/
+
+static boolean TraceLine (int x1, int y1, boolean *door)
 {
-	int	x1,y1,xt1,yt1,x2,y2,xt2,yt2;
+	int	xt1,yt1,x2,y2,xt2,yt2;
 	int	x,y;
 	int	xdist,ydist,xstep,ystep;
 	int	partial,delta;
@@ -966,8 +1335,8 @@ boolean CheckLine (objtype *ob)
 	int	xfrac,yfrac,deltafrac;
 	word	value,intercept;
 
-	x1 = ob->x >> UNSIGNEDSHIFT;		// 1/256 tile precision
-	y1 = ob->y >> UNSIGNEDSHIFT;
+	*door = false;
+
 	xt1 = x1 >> 8;
 	yt1 = y1 >> 8;
 
@@ -1022,6 +1391,7 @@ boolean CheckLine (objtype *ob)
 			//
 			// see if the door is open enough
 			//
+			*door = true;
 			value &= ~0x80;
 			intercept = yfrac-ystep/2;
 
@@ -1076,6 +1446,7 @@ boolean CheckLine (objtype *ob)
 			//
 			// see if the door is open enough
 			//
+			*door = true;
 			value &= ~0x80;
 			intercept = xfrac-xstep/2;
 
@@ -1088,24 +1459,264 @@ boolean CheckLine (objtype *ob)
 }
 
 
+/*
+=====================
+=
+= SightEntry
+=
+= Returns the cache slot for a line from x1,y1 to the player, or NULL if the
+= player's tile can't be seen from the actor's tile at all
+=
+=====================
+*/
+
+static sightcache_t *SightEntry (unsigned x1, unsigned y1)
+{
+	unsigned	actortile,playertile;
+
+	actortile = ((x1>>8)<<6) + (y1>>8);
+	playertile = (player->tilex<<6) + player->tiley;
+
+	if ( !(sightpvs[actortile][playertile>>3] & (1<<(playertile&7))) )
+		return NULL;
+
+	return &sightcache[(actortile + playertile*61) & (SIGHTCACHESIZE-1)];
+}
+
+
+static boolean SightValid (sightcache_t *entry, unsigned x1, unsigned y1)
+{
+	return entry->gen == sightgen && entry->x1 == x1 && entry->y1 == y1
+		&& entry->x2 == plux && entry->y2 == pluy
+		&& entry->playertile == (player->tilex<<6) + player->tiley
+		&& (entry->stamp == SIGHTWALLS || entry->stamp == gamestate.TimeCount);
+}
+
+
+static void SightStore (sightcache_t *entry, unsigned x1, unsigned y1,
+	boolean clear, boolean door)
+{
+	entry->clear = clear;
+	entry->gen = sightgen;
+	entry->x1 = x1;
+	entry->y1 = y1;
+	entry->x2 = plux;
+	entry->y2 = pluy;
+	entry->playertile = (player->tilex<<6) + player->tiley;
+	entry->stamp = door ? gamestate.TimeCount : SIGHTWALLS;
+}
+
 
 /*
-================
+=====================
 =
-= CheckSight
+= CheckLine
 =
-= Checks a straight line between player and current object
+= Returns true if a straight line between the player and ob is unobstructed
 =
-= If the sight is ok, check alertness and angle to see if they notice
+=====================
+*/
+
+boolean CheckLine (objtype *ob)
+{
+	unsigned		x1,y1;
+	sightcache_t	*entry;
+	boolean			clear,door;
+
+	x1 = ob->x >> UNSIGNEDSHIFT;		// 1/256 tile precision
+	y1 = ob->y >> UNSIGNEDSHIFT;
+
+	sightchecks++;
+
+	entry = SightEntry (x1,y1);
+	if (!entry)
+	{
+		sightculled++;
+		return false;
+	}
+
+	if (SightValid (entry,x1,y1))
+	{
+		sightcached++;
+		return entry->clear;
+	}
+
+	clear = TraceLine (x1,y1,&door);
+	SightStore (entry,x1,y1,clear,door);
+
+	return clear;
+}
+
+
+/*
+=============================================================================
+
+A live actor that may look for the player has its line traced before the
+actors think.  Nothing the trace reads changes between the player's think
+and the end of the tic, so the lines are split over several threads.  The
+results are stored in the cache in actor order, and the thinkers then run
+one at a time in list order exactly as before, finding their lines there.
+The thinkers themselves stay serial: they move, hurt, make noise and draw
+random numbers, and the order of all that is what keeps demos in sync.
+
+=============================================================================
+*/
+
+#define THINKTHREADS	4
+#define MINTHREADLINES	8			// fewer are left to the thinkers
+
+#ifdef _REENTRANT
+typedef struct
+{
+	unsigned	x1,y1;
+	boolean		clear,door;
+} sightintent_t;
+
+static	sightintent_t	intents[MAXACTORS];
+static	int				numintents;
+
+static	pthread_t			thinkthreads[THINKTHREADS-1];
+static	pthread_barrier_t	thinkstart,thinkdone;
+static	boolean				thinkthreadsup;
+
+
+/*
+=====================
 =
-= returns true if the player has been spoted
+= TraceIntents
 =
-================
+= Traces every step'th line starting at first.  Only reads the world
+=
+=====================
 */
 
+static void TraceIntents (int first, int step)
+{
+	int		i;
+
+	for (i=first;i<numintents;i+=step)
+		intents[i].clear = TraceLine (intents[i].x1,intents[i].y1,&intents[i].door);
+}
+
+
+static void *ThinkThread (void *arg)
+{
+	int	first = (long)arg;
+
+	for (;;)
+	{
+		pthread_barrier_wait (&thinkstart);
+		TraceIntents (first,THINKTHREADS);
+		pthread_barrier_wait (&thinkdone);
+	}
+
+	return NULL;
+}
+
+
+static void StartThinkThreads (void)
+{
+	long	i;
+
+	pthread_barrier_init (&thinkstart,NULL,THINKTHREADS);
+	pthread_barrier_init (&thinkdone,NULL,THINKTHREADS);
+
+	for (i=1;i<THINKTHREADS;i++)
+		if (pthread_create (&thinkthreads[i-1],NULL,ThinkThread,(void *)i))
+			Quit ("StartThinkThreads: pthread_create failed!");
+
+	thinkthreadsup = true;
+}
+#endif
+
+
+/*
+=====================
+=
+= PrecheckSight
+=
+= Call after the player has moved and before the other actors think.
+= Only lines a thinker would trace this tic are queued: an actor that
+= isn't fighting yet only looks through SightPlayer, so one still counting
+= down its reaction, one that heard a noise, or one CheckSight can answer
+= without a line is left alone.  With too few lines to be worth the
+= threads nothing is traced here, and the thinkers trace their own.
+=
+=====================
+*/
+
+static int SightShortcut (objtype *ob);
+
+void PrecheckSight (void)
+{
+#ifdef _REENTRANT
+	objtype			*ob;
+	sightintent_t	*intent;
+	sightcache_t	*entry;
+	unsigned		x1,y1;
+	int				i;
+
+	numintents = 0;
+
+	for (ob=player->next;ob;ob=ob->next)
+	{
+		if ( !(ob->flags & FL_SHOOTABLE) || !(statelinks[ob->state].flags & SL_THINK) )
+			continue;
+		if (!ob->active && !areabyplayer[ob->areanumber])
+			continue;
+		if ( !(ob->flags & FL_ATTACKMODE) )
+		{
+			if (ob->temp2 || (madenoise && !(ob->flags & FL_AMBUSH)))
+				continue;
+			if (SightShortcut (ob) != -1)
+				continue;
+		}
+
+		x1 = ob->x >> UNSIGNEDSHIFT;
+		y1 = ob->y >> UNSIGNEDSHIFT;
+		entry = SightEntry (x1,y1);
+		if (!entry || SightValid (entry,x1,y1))
+			continue;
+
+		intent = &intents[numintents++];
+		intent->x1 = x1;
+		intent->y1 = y1;
+	}
+
+	if (numintents < MINTHREADLINES)
+		return;
+
+	if (!thinkthreadsup)
+		StartThinkThreads ();
+
+	pthread_barrier_wait (&thinkstart);
+	TraceIntents (0,THINKTHREADS);
+	pthread_barrier_wait (&thinkdone);
+
+	for (i=0,intent=intents;i<numintents;i++,intent++)
+		SightStore (SightEntry (intent->x1,intent->y1),intent->x1,intent->y1,
+			intent->clear,intent->door);
+
+	sightprechecked += numintents;
+#endif
+}
+
+
+
 #define MINSIGHT	0x18000l
 
-boolean CheckSight (objtype *ob)
+/*
+================
+=
+= SightShortcut
+=
+= What CheckSight can tell without tracing a line: true, false, or -1 if
+= it needs the line
+=
+================
+*/
+
+static int SightShortcut (objtype *ob)
 {
 	long		deltax,deltay;
 
@@ -1153,6 +1764,31 @@ boolean CheckSight (objtype *ob)
 		break;
 	}
 
+	return -1;
+}
+
+/*
+================
+=
+= CheckSight
+=
+= Checks a straight line between player and current object
+=
+= If the sight is ok, check alertness and angle to see if they notice
+=
+= returns true if the player has been spoted
+=
+================
+*/
+
+boolean CheckSight (objtype *ob)
+{
+	int		seen;
+
+	seen = SightShortcut (ob);
+	if (seen != -1)
+		return seen;
+
 //
 // trace a line to check for blocking tiles (corners)
 //
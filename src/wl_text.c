@@ -162,7 +162,7 @@ void TimedPicCommand()
 // wait for time
 //
 	set_TimeCount(0);
-	while (get_TimeCount() < picdelay) ;
+	WaitTimeCount(picdelay);
 
 //
 // draw pic
@@ -608,7 +608,10 @@ void ShowArticle(const char *article)
 		}
 
 		LastScan = 0;
-		while (!LastScan) IN_CheckAck(); /* update events */
+		while (!LastScan) {
+			IN_CheckAck(); /* update events */
+			IdleWait();
+		}
 
 		switch (LastScan)
 		{